@@ -113,6 +113,21 @@ if(MOMO_ENABLE_AVX2 AND MSVC AND NOT (CMAKE_SYSTEM_NAME STREQUAL "Android"))
   if (COMPILER_SUPPORTS_ARCH_AVX2)
     momo_add_c_and_cxx_compile_options(/arch:AVX2)
   endif()
+elseif(NOT MSVC AND NOT APPLE AND NOT (CMAKE_SYSTEM_NAME STREQUAL "Android") AND CMAKE_SYSTEM_PROCESSOR MATCHES "^(x86_64|AMD64|amd64)$")
+  # GCC and Clang only define __AVX2__ or __SSE4_1__ when told to, the decoders fall back to scalar code otherwise
+  if(MOMO_ENABLE_AVX2)
+    check_cxx_compiler_flag(-mavx2 COMPILER_SUPPORTS_MAVX2)
+
+    if(COMPILER_SUPPORTS_MAVX2)
+      momo_add_c_and_cxx_compile_options(-mavx2)
+    endif()
+  elseif(MOMO_ENABLE_SSE41)
+    check_cxx_compiler_flag(-msse4.1 COMPILER_SUPPORTS_MSSE41)
+
+    if(COMPILER_SUPPORTS_MSSE41)
+      momo_add_c_and_cxx_compile_options(-msse4.1)
+    endif()
+  endif()
 endif()
 
 ##########################################
@@ -0,0 +1,277 @@
+#include "std_include.hpp"
+
+#include "rocktree/rocktree_proto.hpp"
+#include "rocktree/wire_format.hpp"
+
+#include <utils/io.hpp>
+#include <utils/thread.hpp>
+
+namespace
+{
+    struct benchmark_options
+    {
+        std::filesystem::path corpus_directory{};
+        size_t iterations{20};
+    };
+
+    struct payload_set
+    {
+        std::vector<std::string> nodes{};
+        std::vector<std::string> bulks{};
+        uint64_t node_bytes{};
+        uint64_t bulk_bytes{};
+    };
+
+    void print_usage()
+    {
+        puts("Usage: bird-benchmark --corpus DIR [--iterations N]");
+        puts("Parses every recorded NodeData and BulkMetadata payload with the generated protobuf code and the wire reader.");
+    }
+
+    benchmark_options parse_options(const int argc, char** argv)
+    {
+        benchmark_options options{};
+
+        for (int i = 1; i < argc; ++i)
+        {
+            const std::string arg = argv[i];
+            if ((i + 1) >= argc)
+            {
+                throw std::runtime_error("Missing value for " + arg);
+            }
+
+            const std::string value = argv[++i];
+
+            if (arg == "--corpus")
+            {
+                options.corpus_directory = value;
+            }
+            else if (arg == "--iterations")
+            {
+                options.iterations = std::max<size_t>(1, std::stoul(value));
+            }
+            else
+            {
+                throw std::runtime_error("Unknown option: " + arg);
+            }
+        }
+
+        if (options.corpus_directory.empty())
+        {
+            throw std::runtime_error("No corpus directory specified");
+        }
+
+        return options;
+    }
+
+    // Same layout the server records into, <planet>/NodeData/... and <planet>/BulkMetadata/...
+    payload_set load_payloads(const std::filesystem::path& directory)
+    {
+        payload_set payloads{};
+
+        for (const auto& file : utils::io::list_files(directory, true))
+        {
+            if (std::filesystem::is_directory(file))
+            {
+                continue;
+            }
+
+            const auto type = file.parent_path().filename();
+            if (type != "NodeData" && type != "BulkMetadata")
+            {
+                continue;
+            }
+
+            auto data = utils::io::read_file(file);
+            if (type == "NodeData")
+            {
+                payloads.node_bytes += data.size();
+                payloads.nodes.emplace_back(std::move(data));
+            }
+            else
+            {
+                payloads.bulk_bytes += data.size();
+                payloads.bulks.emplace_back(std::move(data));
+            }
+        }
+
+        return payloads;
+    }
+
+    wire_format::bytes as_bytes(const std::string& data)
+    {
+        return {reinterpret_cast<const uint8_t*>(data.data()), data.size()};
+    }
+
+    // Both parsers touch the fields the decoders use, so lazy parsing can not skip them
+    size_t parse_nodes_protobuf(const std::vector<std::string>& nodes)
+    {
+        size_t checksum = 0;
+
+        for (const auto& data : nodes)
+        {
+            NodeData node_data{};
+            if (!node_data.ParseFromArray(data.data(), static_cast<int>(data.size())))
+            {
+                continue;
+            }
+
+            checksum += node_data.for_normals().size();
+
+            for (const auto& mesh : node_data.meshes())
+            {
+                checksum += mesh.vertices().size() + mesh.indices().size() + mesh.texture_coordinates().size() +
+                            mesh.layer_and_octant_counts().size() + mesh.normals().size();
+
+                if (mesh.texture_size() > 0 && mesh.texture(0).data_size() > 0)
+                {
+                    checksum += mesh.texture(0).data(0).size();
+                }
+            }
+        }
+
+        return checksum;
+    }
+
+    size_t parse_nodes_wire(const std::vector<std::string>& nodes)
+    {
+        size_t checksum = 0;
+
+        for (const auto& data : nodes)
+        {
+            const auto node_data = wire_format::parse_node_data(as_bytes(data));
+            if (!node_data)
+            {
+                continue;
+            }
+
+            checksum += node_data->for_normals.size();
+
+            for (const auto mesh_bytes : node_data->meshes)
+            {
+                const auto mesh = wire_format::parse_mesh(mesh_bytes);
+                if (!mesh)
+                {
+                    break;
+                }
+
+                checksum += mesh->vertices.size() + mesh->indices.size() + mesh->texture_coordinates.size() +
+                            mesh->layer_and_octant_counts.size() + mesh->normals.size() + mesh->texture.data.size();
+            }
+        }
+
+        return checksum;
+    }
+
+    size_t parse_bulks_protobuf(const std::vector<std::string>& bulks)
+    {
+        size_t checksum = 0;
+
+        for (const auto& data : bulks)
+        {
+            BulkMetadata bulk_meta{};
+            if (!bulk_meta.ParseFromArray(data.data(), static_cast<int>(data.size())))
+            {
+                continue;
+            }
+
+            checksum += bulk_meta.head_node_key().epoch();
+
+            for (const auto& node_meta : bulk_meta.node_metadata())
+            {
+                checksum += node_meta.path_and_flags() + node_meta.epoch() + node_meta.oriented_bounding_box().size();
+            }
+        }
+
+        return checksum;
+    }
+
+    size_t parse_bulks_wire(const std::vector<std::string>& bulks)
+    {
+        size_t checksum = 0;
+
+        for (const auto& data : bulks)
+        {
+            const auto bulk_meta = wire_format::parse_bulk_metadata(as_bytes(data));
+            if (!bulk_meta)
+            {
+                continue;
+            }
+
+            checksum += bulk_meta->head_node_epoch;
+
+            for (const auto node_meta_bytes : bulk_meta->node_metadata)
+            {
+                const auto node_meta = wire_format::parse_node_metadata(node_meta_bytes);
+                if (!node_meta)
+                {
+                    break;
+                }
+
+                checksum += node_meta->path_and_flags + node_meta->epoch.value_or(0) +
+                            (node_meta->oriented_bounding_box ? node_meta->oriented_bounding_box->size() : 0);
+            }
+        }
+
+        return checksum;
+    }
+
+    template <typename Parser>
+    void measure(const char* name, const std::vector<std::string>& payloads, const uint64_t bytes, const size_t iterations,
+                 const Parser& parser)
+    {
+        if (payloads.empty())
+        {
+            return;
+        }
+
+        size_t checksum = 0;
+        const auto start = std::chrono::steady_clock::now();
+
+        for (size_t i = 0; i < iterations; ++i)
+        {
+            checksum += parser(payloads);
+        }
+
+        const auto seconds = std::max(std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count(), 1e-9);
+        const auto messages = static_cast<double>(payloads.size() * iterations);
+
+        printf("%-22s %10.2f us/message %10.1f MB/s (checksum %zu)\n", name, seconds * 1e6 / messages,
+               static_cast<double>(bytes * iterations) / (1024.0 * 1024.0) / seconds, checksum / iterations);
+    }
+
+    void run(const benchmark_options& options)
+    {
+        const auto payloads = load_payloads(options.corpus_directory);
+        if (payloads.nodes.empty() && payloads.bulks.empty())
+        {
+            throw std::runtime_error("No NodeData or BulkMetadata payloads found");
+        }
+
+        printf("%zu nodes (%.2f MB), %zu bulks (%.2f MB), %zu iterations\n", payloads.nodes.size(),
+               static_cast<double>(payloads.node_bytes) / (1024.0 * 1024.0), payloads.bulks.size(),
+               static_cast<double>(payloads.bulk_bytes) / (1024.0 * 1024.0), options.iterations);
+
+        measure("NodeData protobuf", payloads.nodes, payloads.node_bytes, options.iterations, parse_nodes_protobuf);
+        measure("NodeData wire", payloads.nodes, payloads.node_bytes, options.iterations, parse_nodes_wire);
+        measure("BulkMetadata protobuf", payloads.bulks, payloads.bulk_bytes, options.iterations, parse_bulks_protobuf);
+        measure("BulkMetadata wire", payloads.bulks, payloads.bulk_bytes, options.iterations, parse_bulks_wire);
+    }
+}
+
+int main(const int argc, char** argv)
+{
+    try
+    {
+        utils::thread::set_name("Main");
+        run(parse_options(argc, argv));
+        return 0;
+    }
+    catch (std::exception& e)
+    {
+        puts(e.what());
+        print_usage();
+    }
+
+    return 1;
+}
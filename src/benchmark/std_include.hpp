@@ -0,0 +1,22 @@
+#pragma once
+
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <vector>
+#include <string>
+#include <memory>
+#include <span>
+#include <limits>
+#include <utility>
+#include <optional>
+#include <algorithm>
+#include <stdexcept>
+#include <filesystem>
+#include <functional>
+#include <string_view>
+
+#include <cstdio>
+#include <cstring>
+
+using namespace std::literals;
@@ -0,0 +1,343 @@
+#include "std_include.hpp"
+
+#include "bc1_encoder.hpp"
+
+#if defined(__SSE2__) || defined(_M_X64)
+#define BC1_USE_SSE2
+#include <emmintrin.h>
+#endif
+
+namespace bc1
+{
+    namespace
+    {
+        constexpr size_t pixels_per_block = 16;
+
+        struct color_block
+        {
+            alignas(16) uint8_t pixels[pixels_per_block][4]{};
+        };
+
+        struct color
+        {
+            int32_t r{};
+            int32_t g{};
+            int32_t b{};
+        };
+
+        void extract_block(const uint8_t* pixels, const int width, const int height, const int components, const int block_x,
+                           const int block_y, color_block& block)
+        {
+            for (int y = 0; y < 4; ++y)
+            {
+                const auto source_y = std::min(block_y * 4 + y, height - 1);
+
+                for (int x = 0; x < 4; ++x)
+                {
+                    const auto source_x = std::min(block_x * 4 + x, width - 1);
+                    const auto* source = pixels + (static_cast<size_t>(source_y) * width + source_x) * components;
+
+                    auto& target = block.pixels[y * 4 + x];
+                    target[0] = source[0];
+                    target[1] = source[1];
+                    target[2] = source[2];
+                    target[3] = 0;
+                }
+            }
+        }
+
+        void get_bounds(const color_block& block, color& min, color& max)
+        {
+#ifdef BC1_USE_SSE2
+            const auto* rows = reinterpret_cast<const __m128i*>(block.pixels);
+            const auto r0 = _mm_load_si128(rows + 0);
+            const auto r1 = _mm_load_si128(rows + 1);
+            const auto r2 = _mm_load_si128(rows + 2);
+            const auto r3 = _mm_load_si128(rows + 3);
+
+            auto low = _mm_min_epu8(_mm_min_epu8(r0, r1), _mm_min_epu8(r2, r3));
+            auto high = _mm_max_epu8(_mm_max_epu8(r0, r1), _mm_max_epu8(r2, r3));
+
+            low = _mm_min_epu8(low, _mm_shuffle_epi32(low, 0x4E));
+            low = _mm_min_epu8(low, _mm_shuffle_epi32(low, 0xB1));
+            high = _mm_max_epu8(high, _mm_shuffle_epi32(high, 0x4E));
+            high = _mm_max_epu8(high, _mm_shuffle_epi32(high, 0xB1));
+
+            const auto low_value = static_cast<uint32_t>(_mm_cvtsi128_si32(low));
+            const auto high_value = static_cast<uint32_t>(_mm_cvtsi128_si32(high));
+
+            min = {static_cast<int32_t>(low_value & 0xFF), static_cast<int32_t>((low_value >> 8) & 0xFF),
+                   static_cast<int32_t>((low_value >> 16) & 0xFF)};
+            max = {static_cast<int32_t>(high_value & 0xFF), static_cast<int32_t>((high_value >> 8) & 0xFF),
+                   static_cast<int32_t>((high_value >> 16) & 0xFF)};
+#else
+            min = {255, 255, 255};
+            max = {0, 0, 0};
+
+            for (const auto& pixel : block.pixels)
+            {
+                min.r = std::min<int32_t>(min.r, pixel[0]);
+                min.g = std::min<int32_t>(min.g, pixel[1]);
+                min.b = std::min<int32_t>(min.b, pixel[2]);
+
+                max.r = std::max<int32_t>(max.r, pixel[0]);
+                max.g = std::max<int32_t>(max.g, pixel[1]);
+                max.b = std::max<int32_t>(max.b, pixel[2]);
+            }
+#endif
+        }
+
+        // Pulls both endpoints 1/16th towards each other, which reduces the error of the interpolated colors
+        void inset_bounds(color& min, color& max)
+        {
+            const auto inset = [](int32_t& low, int32_t& high) {
+                const auto delta = (high - low) >> 4;
+                low += delta;
+                high -= delta;
+            };
+
+            inset(min.r, max.r);
+            inset(min.g, max.g);
+            inset(min.b, max.b);
+        }
+
+        uint16_t to_565(const color& c)
+        {
+            const auto r = static_cast<uint16_t>((c.r * 31 + 127) / 255);
+            const auto g = static_cast<uint16_t>((c.g * 63 + 127) / 255);
+            const auto b = static_cast<uint16_t>((c.b * 31 + 127) / 255);
+
+            return static_cast<uint16_t>((r << 11) | (g << 5) | b);
+        }
+
+        color from_565(const uint16_t value)
+        {
+            const auto r = (value >> 11) & 0x1F;
+            const auto g = (value >> 5) & 0x3F;
+            const auto b = value & 0x1F;
+
+            return {(r << 3) | (r >> 2), (g << 2) | (g >> 4), (b << 3) | (b >> 2)};
+        }
+
+        // Projects every pixel onto the endpoint axis and quantizes it to one of the 4 palette steps (0 = end, 3 = start)
+        void compute_steps(const color_block& block, const color& end, const color& axis, std::array<int32_t, pixels_per_block>& steps)
+        {
+            const auto length = axis.r * axis.r + axis.g * axis.g + axis.b * axis.b;
+            const auto scale = 3.0f / static_cast<float>(length);
+
+#ifdef BC1_USE_SSE2
+            const auto zero = _mm_setzero_si128();
+            const auto origin = _mm_setr_epi16(static_cast<int16_t>(end.r), static_cast<int16_t>(end.g), static_cast<int16_t>(end.b), 0,
+                                               static_cast<int16_t>(end.r), static_cast<int16_t>(end.g), static_cast<int16_t>(end.b), 0);
+            const auto direction =
+                _mm_setr_epi16(static_cast<int16_t>(axis.r), static_cast<int16_t>(axis.g), static_cast<int16_t>(axis.b), 0,
+                               static_cast<int16_t>(axis.r), static_cast<int16_t>(axis.g), static_cast<int16_t>(axis.b), 0);
+
+            const auto scale_vec = _mm_set1_ps(scale);
+            const auto half = _mm_set1_ps(0.5f);
+            const auto max_step = _mm_set1_ps(3.0f);
+
+            const auto* rows = reinterpret_cast<const __m128i*>(block.pixels);
+
+            for (size_t i = 0; i < 4; ++i)
+            {
+                const auto row = _mm_load_si128(rows + i);
+
+                const auto low = _mm_madd_epi16(_mm_sub_epi16(_mm_unpacklo_epi8(row, zero), origin), direction);
+                const auto high = _mm_madd_epi16(_mm_sub_epi16(_mm_unpackhi_epi8(row, zero), origin), direction);
+
+                const auto even = _mm_castps_si128(_mm_shuffle_ps(_mm_castsi128_ps(low), _mm_castsi128_ps(high), _MM_SHUFFLE(2, 0, 2, 0)));
+                const auto odd = _mm_castps_si128(_mm_shuffle_ps(_mm_castsi128_ps(low), _mm_castsi128_ps(high), _MM_SHUFFLE(3, 1, 3, 1)));
+                const auto dots = _mm_add_epi32(even, odd);
+
+                auto projected = _mm_mul_ps(_mm_cvtepi32_ps(dots), scale_vec);
+                projected = _mm_min_ps(_mm_max_ps(projected, _mm_setzero_ps()), max_step);
+
+                const auto rounded = _mm_cvttps_epi32(_mm_add_ps(projected, half));
+                _mm_storeu_si128(reinterpret_cast<__m128i*>(steps.data() + i * 4), rounded);
+            }
+#else
+            for (size_t i = 0; i < pixels_per_block; ++i)
+            {
+                const auto& pixel = block.pixels[i];
+                const auto dot = (pixel[0] - end.r) * axis.r + (pixel[1] - end.g) * axis.g + (pixel[2] - end.b) * axis.b;
+                const auto projected = std::clamp(static_cast<float>(dot) * scale, 0.0f, 3.0f);
+                steps[i] = static_cast<int32_t>(projected + 0.5f);
+            }
+#endif
+        }
+
+        void encode_block(const color_block& block, uint8_t* output)
+        {
+            color min{}, max{};
+            get_bounds(block, min, max);
+            inset_bounds(min, max);
+
+            const auto start_value = to_565(max);
+            const auto end_value = to_565(min);
+
+            uint32_t indices = 0;
+
+            if (start_value != end_value)
+            {
+                const auto start = from_565(start_value);
+                const auto end = from_565(end_value);
+                const color axis{start.r - end.r, start.g - end.g, start.b - end.b};
+
+                std::array<int32_t, pixels_per_block> steps{};
+                compute_steps(block, end, axis, steps);
+
+                // Palette order is start, end, 2/3 start + 1/3 end, 1/3 start + 2/3 end
+                constexpr uint32_t step_to_index[4] = {1, 3, 2, 0};
+
+                for (size_t i = 0; i < pixels_per_block; ++i)
+                {
+                    indices |= step_to_index[steps[i]] << (i * 2);
+                }
+            }
+
+            memcpy(output + 0, &start_value, sizeof(start_value));
+            memcpy(output + 2, &end_value, sizeof(end_value));
+            memcpy(output + 4, &indices, sizeof(indices));
+        }
+
+        void decode_block(const uint8_t* input, color_block& block)
+        {
+            uint16_t start_value{}, end_value{};
+            uint32_t indices{};
+
+            memcpy(&start_value, input + 0, sizeof(start_value));
+            memcpy(&end_value, input + 2, sizeof(end_value));
+            memcpy(&indices, input + 4, sizeof(indices));
+
+            const auto start = from_565(start_value);
+            const auto end = from_565(end_value);
+
+            std::array<color, 4> palette{start, end};
+
+            if (start_value > end_value)
+            {
+                palette[2] = {(2 * start.r + end.r) / 3, (2 * start.g + end.g) / 3, (2 * start.b + end.b) / 3};
+                palette[3] = {(start.r + 2 * end.r) / 3, (start.g + 2 * end.g) / 3, (start.b + 2 * end.b) / 3};
+            }
+            else
+            {
+                // 3 color mode, the transparent entry is treated as black
+                palette[2] = {(start.r + end.r) / 2, (start.g + end.g) / 2, (start.b + end.b) / 2};
+                palette[3] = {};
+            }
+
+            for (size_t i = 0; i < pixels_per_block; ++i)
+            {
+                const auto& c = palette[(indices >> (i * 2)) & 3];
+
+                auto& target = block.pixels[i];
+                target[0] = static_cast<uint8_t>(c.r);
+                target[1] = static_cast<uint8_t>(c.g);
+                target[2] = static_cast<uint8_t>(c.b);
+                target[3] = 0;
+            }
+        }
+    }
+
+    size_t get_encoded_size(const int width, const int height)
+    {
+        const auto blocks_x = static_cast<size_t>((width + 3) / 4);
+        const auto blocks_y = static_cast<size_t>((height + 3) / 4);
+
+        return blocks_x * blocks_y * block_size;
+    }
+
+    std::vector<uint8_t> encode(const uint8_t* pixels, const int width, const int height, const int components)
+    {
+        if (!pixels || width <= 0 || height <= 0 || components < 3)
+        {
+            return {};
+        }
+
+        std::vector<uint8_t> output(get_encoded_size(width, height));
+
+        const auto blocks_x = (width + 3) / 4;
+        const auto blocks_y = (height + 3) / 4;
+
+        color_block block{};
+        auto* target = output.data();
+
+        for (int y = 0; y < blocks_y; ++y)
+        {
+            for (int x = 0; x < blocks_x; ++x)
+            {
+                extract_block(pixels, width, height, components, x, y, block);
+                encode_block(block, target);
+                target += block_size;
+            }
+        }
+
+        return output;
+    }
+
+    std::vector<uint8_t> downsample(const uint8_t* blocks, const int width, const int height)
+    {
+        if (!blocks || width <= 0 || height <= 0)
+        {
+            return {};
+        }
+
+        const auto source_blocks_x = (width + 3) / 4;
+        const auto source_blocks_y = (height + 3) / 4;
+
+        const auto target_width = std::max(1, width / 2);
+        const auto target_height = std::max(1, height / 2);
+        const auto target_blocks_x = (target_width + 3) / 4;
+        const auto target_blocks_y = (target_height + 3) / 4;
+
+        std::vector<uint8_t> output(get_encoded_size(target_width, target_height));
+
+        std::array<color_block, 4> sources{};
+        color_block block{};
+        auto* target = output.data();
+
+        for (int y = 0; y < target_blocks_y; ++y)
+        {
+            for (int x = 0; x < target_blocks_x; ++x)
+            {
+                // Blocks past the edge are clamped, they only feed pixels outside the target level
+                for (int i = 0; i < 4; ++i)
+                {
+                    const auto source_x = std::min(x * 2 + (i & 1), source_blocks_x - 1);
+                    const auto source_y = std::min(y * 2 + (i >> 1), source_blocks_y - 1);
+
+                    decode_block(blocks + (static_cast<size_t>(source_y) * source_blocks_x + source_x) * block_size, sources[i]);
+                }
+
+                for (int py = 0; py < 4; ++py)
+                {
+                    for (int px = 0; px < 4; ++px)
+                    {
+                        const auto& source = sources[(py >> 1) * 2 + (px >> 1)];
+                        const auto sx = (px & 1) * 2;
+                        const auto sy = (py & 1) * 2;
+
+                        const auto* p0 = source.pixels[sy * 4 + sx];
+                        const auto* p1 = source.pixels[sy * 4 + sx + 1];
+                        const auto* p2 = source.pixels[(sy + 1) * 4 + sx];
+                        const auto* p3 = source.pixels[(sy + 1) * 4 + sx + 1];
+
+                        auto& pixel = block.pixels[py * 4 + px];
+                        for (int c = 0; c < 3; ++c)
+                        {
+                            pixel[c] = static_cast<uint8_t>((p0[c] + p1[c] + p2[c] + p3[c] + 2) >> 2);
+                        }
+
+                        pixel[3] = 0;
+                    }
+                }
+
+                encode_block(block, target);
+                target += block_size;
+            }
+        }
+
+        return output;
+    }
+}
@@ -0,0 +1,14 @@
+#pragma once
+
+namespace bc1
+{
+    constexpr size_t block_size = 8;
+
+    size_t get_encoded_size(int width, int height);
+
+    // Compresses 8 bit RGB(A) pixels into DXT1 blocks, alpha is ignored
+    std::vector<uint8_t> encode(const uint8_t* pixels, int width, int height, int components);
+
+    // Builds the next mip level straight from DXT1 blocks, every 2x2 block group is decoded, box filtered and re-encoded
+    std::vector<uint8_t> downsample(const uint8_t* blocks, int width, int height);
+}
@@ -0,0 +1,138 @@
+#include "std_include.hpp"
+
+#include "jpeg_decoder.hpp"
+#include "texture_mipmaps.hpp"
+
+#pragma warning(push)
+#pragma warning(disable : 4100)
+#pragma warning(disable : 4127)
+#pragma warning(disable : 4244)
+#pragma warning(disable : 6262)
+
+#ifdef HAS_LIBJPEG_TURBO
+#include <csetjmp>
+#include <cstdio>
+#include <jpeglib.h>
+#endif
+
+#define STB_IMAGE_IMPLEMENTATION
+#include <stb_image.h>
+
+#pragma warning(pop)
+
+namespace jpeg_decoder
+{
+    namespace
+    {
+        constexpr int rgb_components = 3;
+
+        std::optional<image> decode_stb(const std::span<const uint8_t> data, const int scale_shift)
+        {
+            int width{}, height{}, comp{};
+            auto* pixels = stbi_load_from_memory(data.data(), static_cast<int>(data.size()), &width, &height, &comp, rgb_components);
+            if (!pixels)
+            {
+                return {};
+            }
+
+            image result{};
+            result.width = width;
+            result.height = height;
+            result.pixels.assign(pixels, pixels + static_cast<size_t>(width) * height * rgb_components);
+
+            stbi_image_free(pixels);
+
+            for (int i = 0; i < scale_shift; ++i)
+            {
+                result.pixels = texture_mipmaps::downsample_rgb(result.pixels.data(), result.width, result.height);
+                result.width = std::max(1, result.width / 2);
+                result.height = std::max(1, result.height / 2);
+            }
+
+            return result;
+        }
+
+#ifdef HAS_LIBJPEG_TURBO
+        struct error_manager
+        {
+            jpeg_error_mgr manager{};
+            std::jmp_buf jump_buffer{};
+        };
+
+        [[noreturn]] void handle_error(const j_common_ptr info)
+        {
+            auto* errors = reinterpret_cast<error_manager*>(info->err);
+            std::longjmp(errors->jump_buffer, 1);
+        }
+
+        void ignore_message(const j_common_ptr)
+        {
+        }
+
+        // Only trivially destructible locals live in here, the longjmp on errors must not skip any destructors
+        bool decode_libjpeg(const std::span<const uint8_t> data, const int scale_shift, image& result)
+        {
+            jpeg_decompress_struct info{};
+            error_manager errors{};
+
+            info.err = jpeg_std_error(&errors.manager);
+            errors.manager.error_exit = handle_error;
+            errors.manager.output_message = ignore_message;
+
+            if (setjmp(errors.jump_buffer))
+            {
+                jpeg_destroy_decompress(&info);
+                return false;
+            }
+
+            jpeg_create_decompress(&info);
+            jpeg_mem_src(&info, data.data(), static_cast<unsigned long>(data.size()));
+
+            if (jpeg_read_header(&info, TRUE) != JPEG_HEADER_OK)
+            {
+                jpeg_destroy_decompress(&info);
+                return false;
+            }
+
+            info.out_color_space = JCS_RGB;
+            info.scale_num = 1;
+            info.scale_denom = 1u << scale_shift;
+
+            jpeg_start_decompress(&info);
+
+            result.width = static_cast<int>(info.output_width);
+            result.height = static_cast<int>(info.output_height);
+            result.pixels.resize(static_cast<size_t>(info.output_width) * info.output_height * rgb_components);
+
+            const auto stride = static_cast<size_t>(info.output_width) * rgb_components;
+
+            while (info.output_scanline < info.output_height)
+            {
+                JSAMPROW row = result.pixels.data() + info.output_scanline * stride;
+                jpeg_read_scanlines(&info, &row, 1);
+            }
+
+            jpeg_finish_decompress(&info);
+            jpeg_destroy_decompress(&info);
+
+            // Truncated or corrupt data only raises warnings and decodes as gray, that would end up in the texture
+            return errors.manager.num_warnings == 0;
+        }
+#endif
+    }
+
+    std::optional<image> decode(const std::span<const uint8_t> data, int scale_shift)
+    {
+        scale_shift = std::clamp(scale_shift, 0, max_scale_shift);
+
+#ifdef HAS_LIBJPEG_TURBO
+        image result{};
+        if (decode_libjpeg(data, scale_shift, result))
+        {
+            return result;
+        }
+#endif
+
+        return decode_stb(data, scale_shift);
+    }
+}
@@ -0,0 +1,18 @@
+#pragma once
+
+namespace jpeg_decoder
+{
+    struct image
+    {
+        std::vector<uint8_t> pixels{}; // 8 bit RGB
+        int width{};
+        int height{};
+    };
+
+    // Largest supported scale_shift, 2 decodes at a quarter of the resolution
+    constexpr int max_scale_shift = 2;
+
+    // Decodes at 1 / (1 << scale_shift) of the full resolution. libjpeg-turbo skips the discarded frequencies in its
+    // SIMD IDCT, the stb fallback decodes the full image and box filters it.
+    std::optional<image> decode(std::span<const uint8_t> data, int scale_shift = 0);
+}
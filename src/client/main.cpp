@@ -28,66 +28,6 @@ namespace
 {
     constexpr float ANIMATION_TIME = 350.0f;
 
-    bool perform_object_cleanup(generic_object& obj)
-    {
-        if (obj.try_perform_deletion())
-        {
-            return true;
-        }
-
-        if (!obj.was_used_within(10s, 5s, 3s))
-        {
-            obj.mark_for_deletion();
-            return true;
-        }
-
-        return false;
-    }
-
-    void perform_bulk_cleanup(bulk& current_bulk)
-    {
-        if (perform_object_cleanup(current_bulk) || !current_bulk.is_in_final_state())
-        {
-            return;
-        }
-
-        for (const auto& [_, node] : current_bulk.nodes)
-        {
-            perform_object_cleanup(*node);
-        }
-
-        for (const auto& [_, bulk] : current_bulk.bulks)
-        {
-            perform_bulk_cleanup(*bulk);
-        }
-    }
-
-    void perform_cleanup(rocktree& rocktree, const bool clean)
-    {
-        if (clean)
-        {
-            profiler p("Clean");
-            p.silence();
-
-            const auto planetoid = rocktree.get_planetoid();
-            if (!planetoid || !planetoid->is_in_final_state())
-                return;
-
-            const auto& current_bulk = planetoid->root_bulk;
-            if (!current_bulk || !current_bulk->is_in_final_state())
-                return;
-
-            perform_bulk_cleanup(*current_bulk);
-        }
-        else
-        {
-            profiler p("Dangling");
-            p.silence();
-
-            rocktree.cleanup_dangling_objects(300ms);
-        }
-    }
-
     constexpr double A_EARTH = 6378.1370;
     constexpr double EARTH_ECC = 0.08181919084262157;
     constexpr double NAV_E2 = EARTH_ECC * EARTH_ECC;
@@ -331,7 +271,6 @@ namespace
 
     struct rendering_context : simulation_objects, fps_context, shooting_context
     {
-        utils::concurrency::container<std::queue<world_mesh*>> meshes_to_buffer{};
         bool gravity_on{true};
         double render_distance{1.2};
         uint64_t last_vertices{0};
@@ -353,6 +292,43 @@ namespace
         }
     }
 
+    std::string get_decision_name(const utils::http::concurrency_controller::decision decision)
+    {
+        switch (decision)
+        {
+        case utils::http::concurrency_controller::decision::increase:
+            return "increasing";
+        case utils::http::concurrency_controller::decision::decrease:
+            return "decreasing";
+        default:
+            return "holding";
+        }
+    }
+
+    std::string get_stage_times(const pipeline::stats& stats)
+    {
+        std::string text = "Stages:";
+
+        for (size_t i = 0; i < static_cast<size_t>(pipeline::stage::count); ++i)
+        {
+            const auto s = static_cast<pipeline::stage>(i);
+            text += (i == 0 ? " " : ", ");
+            text += pipeline::get_stage_name(s);
+            text += " " + std::to_string(stats.get_average(s).count());
+        }
+
+        return text + " us";
+    }
+
+    std::string get_vertex_cache_text(const vertex_cache_stats& stats)
+    {
+        char text[128]{};
+        snprintf(text, sizeof(text), "ACMR: %.3f strip, %.3f list (%llu triangles)", stats.strip_acmr, stats.list_acmr,
+                 static_cast<unsigned long long>(stats.triangles));
+
+        return text;
+    }
+
     void draw_text(const rendering_context& c, world& game_world, const size_t buffer_queue, const uint64_t current_vertices)
     {
         constexpr auto color = glm::vec4(0.1f, 0.1f, 0.1f, 1.0f);
@@ -362,8 +338,31 @@ namespace
         c.renderer.draw("FPS: " + std::to_string(c.fps), 25.0f, (offset += 25.0f), 1.0f, color);
         c.renderer.draw("Tasks: " + std::to_string(c.rock_tree.get_tasks()), 25.0f, (offset += 25.0f), 1.0f, color);
         c.renderer.draw("Downloads: " + std::to_string(c.rock_tree.get_downloads()), 25.0f, (offset += 25.0f), 1.0f, color);
-        c.renderer.draw("Buffering: " + std::to_string(buffer_queue), 25.0f, (offset += 25.0f), 1.0f, color);
-        c.renderer.draw("Objects: " + std::to_string(c.rock_tree.get_objects()), 25.0f, (offset += 25.0f), 1.0f, color);
+        const auto download_state = c.rock_tree.get_download_state();
+        c.renderer.draw("Concurrency: " + std::to_string(download_state.limit) + " (" + get_decision_name(download_state.last_decision) +
+                            ", " + std::to_string(static_cast<int>(download_state.throughput / 1024.0)) + " KB/s, " +
+                            std::to_string(download_state.latency.count()) + " ms, " +
+                            std::to_string(static_cast<int>(download_state.error_rate * 100.0)) + "% errors)",
+                        25.0f, (offset += 25.0f), 1.0f, color);
+        c.renderer.draw("IO: " + std::to_string(c.rock_tree.get_io_operations()) + " (" +
+                            std::to_string(c.rock_tree.get_io_latency().count()) + " us)",
+                        25.0f, (offset += 25.0f), 1.0f, color);
+        const auto failures = c.rock_tree.get_fetch_failures();
+        c.renderer.draw("Failures: " + std::to_string(failures.not_found) + " missing, " + std::to_string(failures.server_errors) +
+                            " server, " + std::to_string(failures.network_errors + failures.other_errors) + " other (" +
+                            std::to_string(failures.entries) + " backing off)",
+                        25.0f, (offset += 25.0f), 1.0f, color);
+        c.renderer.draw("Buffering: " + std::to_string(buffer_queue) + " (" +
+                            std::to_string(game_world.get_decoded_texture_bytes() / (1024 * 1024)) + " MB decoded)",
+                        25.0f, (offset += 25.0f), 1.0f, color);
+        c.renderer.draw(get_stage_times(c.rock_tree.get_pipeline_stats()), 25.0f, (offset += 25.0f), 1.0f, color);
+        c.renderer.draw(get_vertex_cache_text(c.rock_tree.get_vertex_cache_stats()), 25.0f, (offset += 25.0f), 1.0f, color);
+        const auto bulk_pool = c.rock_tree.get_bulk_pool_stats();
+        const auto node_pool = c.rock_tree.get_node_pool_stats();
+        c.renderer.draw("Objects: " + std::to_string(c.rock_tree.get_objects()) + " (" + std::to_string(bulk_pool.used) + "/" +
+                            std::to_string(bulk_pool.capacity) + " bulks, " + std::to_string(node_pool.used) + "/" +
+                            std::to_string(node_pool.capacity) + " nodes pooled)",
+                        25.0f, (offset += 25.0f), 1.0f, color);
         c.renderer.draw("Vertices: " + std::to_string(current_vertices), 25.0f, (offset += 25.0f), 1.0f, color);
         c.renderer.draw("Distance: " + std::to_string(c.render_distance), 25.0f, (offset += 25.0f), 1.0f, color);
         c.renderer.draw("Gravity: " + std::string(c.gravity_on ? "on" : "off"), 25.0f, (offset += 25.0f), 1.0f, color);
@@ -371,37 +370,15 @@ namespace
                         color);
     }
 
-    size_t push_meshes_for_buffering(rendering_context& c, std::queue<world_mesh*> new_meshes_to_buffer)
+    size_t get_buffer_queue_size(world& game_world)
     {
-        size_t buffer_queue{0};
-
-        c.meshes_to_buffer.access([&](std::queue<::world_mesh*>& meshes) {
-            buffer_queue = meshes.size() + new_meshes_to_buffer.size();
-
-            if (meshes.empty())
-            {
-                meshes = std::move(new_meshes_to_buffer);
-                return;
-            }
-
-            while (!new_meshes_to_buffer.empty())
-            {
-                auto* node = new_meshes_to_buffer.front();
-                new_meshes_to_buffer.pop();
-
-                meshes.push(node);
-            }
-        });
-
-        return buffer_queue;
+        return game_world.get_upload_queue().size();
     }
 
-    std::queue<world_mesh*> draw_world(profiler& p, const world& game_world, const uint64_t frame_index, const float current_time,
-                                       const glm::dmat4& viewprojection, uint64_t& current_vertices,
-                                       const std::map<octant_identifier<>, node*>& potential_nodes)
+    void draw_world(profiler& p, const world& game_world, const uint64_t frame_index, const float current_time,
+                    const glm::dmat4& viewprojection, uint64_t& current_vertices,
+                    const std::map<octant_identifier<>, node*>& potential_nodes)
     {
-        std::queue<world_mesh*> new_meshes_to_buffer{};
-
         using mask_list = std::array<int, 8>;
         using time_list = std::array<float, 8>;
 
@@ -436,11 +413,7 @@ namespace
 
             if (!mesh.is_buffered())
             {
-                if (mesh.mark_for_buffering())
-                {
-                    new_meshes_to_buffer.push(&mesh);
-                }
-
+                mesh.mark_for_buffering();
                 continue;
             }
 
@@ -474,13 +447,19 @@ namespace
 
             p.step("Loop2Draw");
 
-            mask_entry.times[octant] = mesh.draw(ctx, frame_index, current_time, mask.times, mask.masks);
+            mask_entry.times[octant] = mesh.draw(ctx, frame_index, current_time, ANIMATION_TIME, mask.times, mask.masks);
             current_vertices += node->get_vertices();
 
             p.step("Loop 2");
         }
+    }
 
-        return new_meshes_to_buffer;
+    // The screen-space error already falls off with distance. Coarser levels go first, as they are needed
+    // before their children can refine them, and nodes behind the camera only matter once it turns.
+    double get_fetch_priority(const double screen_space_error, const size_t level, const bool is_visible)
+    {
+        const auto visibility_factor = is_visible ? 1.0 : 0.1;
+        return visibility_factor * screen_space_error / static_cast<double>(std::max<size_t>(level, 1));
     }
 
     std::map<octant_identifier<>, node*> select_nodes(const rendering_context& c, const glm::dmat4& viewprojection, bulk* current_bulk)
@@ -491,8 +470,6 @@ namespace
 
         const auto frustum_planes = get_frustum_planes(viewprojection);
 
-        auto lock = c.rock_tree.get_task_manager().lock_high_priority();
-
         while (!valid.empty())
         {
             const auto& entry = valid.front();
@@ -553,6 +530,8 @@ namespace
                     {
                         continue;
                     }
+
+                    node->set_fetch_priority(get_fetch_priority(r / texels_per_meter, nxt.size(), is_visible));
                 }
 
                 if (node->use() && node->can_have_data && is_visible)
@@ -802,7 +781,7 @@ namespace
 
     bool has_meshes_to_buffer(rendering_context& c)
     {
-        return c.meshes_to_buffer.access<bool>([](const std::queue<world_mesh*>& q) { return !q.empty(); });
+        return get_buffer_queue_size(c.rock_tree.with<world>()) > 0;
     }
 
     void run_frame(rendering_context& c, profiler& p)
@@ -810,15 +789,19 @@ namespace
         const auto frame_index = ++c.total_frame_counter;
         const auto current_time = static_cast<float>(c.win.get_current_time());
 
+        // Nothing found in the tree during the last frame is referenced anymore
+        c.rock_tree.advance_epoch();
+
         uint64_t current_vertices = 0;
         const auto _ = utils::finally([&] { c.last_vertices = current_vertices; });
 
         if (!c.is_ready)
         {
-            c.is_ready = frame_index > 30                    //
-                         && c.rock_tree.get_tasks() == 0     //
-                         && c.rock_tree.get_downloads() == 0 //
-                         && c.rock_tree.get_objects() > 1    //
+            c.is_ready = frame_index > 30                        //
+                         && c.rock_tree.get_tasks() == 0         //
+                         && c.rock_tree.get_downloads() == 0     //
+                         && c.rock_tree.get_io_operations() == 0 //
+                         && c.rock_tree.get_objects() > 1        //
                          && !has_meshes_to_buffer(c);
         }
 
@@ -878,8 +861,11 @@ namespace
         p.step("Select nodes");
         const auto potential_nodes = select_nodes(c, viewprojection, current_bulk);
 
+        // Queued fetches and decodes are reordered by the priorities selection just assigned
+        c.rock_tree.get_task_manager().update_scores();
+
         p.step("Render");
-        auto new_meshes_to_buffer = draw_world(p, game_world, frame_index, current_time, viewprojection, current_vertices, potential_nodes);
+        draw_world(p, game_world, frame_index, current_time, viewprojection, current_vertices, potential_nodes);
 
         game_world.get_multiplayer().access_players([&](const players& players) {
             for (const auto& [_, player] : players)
@@ -888,8 +874,8 @@ namespace
             }
         });
 
-        p.step("Push buffer");
-        const auto buffer_queue = push_meshes_for_buffering(c, std::move(new_meshes_to_buffer));
+        p.step("Count buffer");
+        const auto buffer_queue = get_buffer_queue_size(game_world);
 
         c.xhair.draw();
 
@@ -921,46 +907,28 @@ namespace
     }
 #endif
 
-    bool buffer_queue(utils::concurrency::container<std::queue<world_mesh*>>& meshes_to_buffer)
+    bool buffer_queue(world& game_world)
     {
-        std::queue<world_mesh*> mesh_queue{};
-
-        meshes_to_buffer.access([&mesh_queue](std::queue<world_mesh*>& nodes) {
-            if (nodes.empty())
-            {
-                return;
-            }
-
-            mesh_queue = std::move(nodes);
-            nodes = {};
-        });
-
-        if (mesh_queue.empty())
+        if (!game_world.get_upload_queue().run())
         {
             return false;
         }
 
-        world_mesh::buffer_queue(mesh_queue);
+        glFinish();
+
+        game_world.get_upload_fence().run();
         return true;
     }
 
     void bufferer(rendering_context& c, const utils::thread::stop_token& token)
     {
         c.win.use_shared_context([&] {
-            bool clean = false;
-            auto last_cleanup_frame = c.total_frame_counter.load();
             while (!token.stop_requested())
             {
                 c.rock_tree.with<world>().get_bufferer().perform_cleanup();
+                c.rock_tree.reclaim_objects(5ms);
 
-                if (c.total_frame_counter > (last_cleanup_frame + 6))
-                {
-                    clean = !clean;
-                    perform_cleanup(c.rock_tree, clean);
-                    last_cleanup_frame = c.total_frame_counter.load();
-                }
-
-                if (!buffer_queue(c.meshes_to_buffer))
+                if (!buffer_queue(c.rock_tree.with<world>()))
                 {
                     std::this_thread::sleep_for(10ms);
                 }
@@ -989,7 +957,20 @@ namespace
         return get_resource(fs, "resources/shader/world.fs.glsl");
     }
 
-    void run()
+    std::string get_base_url(const int argc, char** argv)
+    {
+        for (int i = 1; (i + 1) < argc; ++i)
+        {
+            if (std::string_view(argv[i]) == "--url")
+            {
+                return argv[i + 1];
+            }
+        }
+
+        return rocktree::default_base_url;
+    }
+
+    void run(const std::string& base_url)
     {
 #ifdef _WIN32
         if (utils::nt::is_wine())
@@ -1009,7 +990,7 @@ namespace
         input input_handler(win);
 
         world game_world{get_vertex_shader(fs), get_fragment_shader(fs)};
-        custom_rocktree<world, world_mesh> rock_tree{"earth", game_world};
+        custom_rocktree<world, world_mesh> rock_tree{"earth", game_world, base_url};
 
         auto eye = lla_to_ecef(48.8605, 2.2914, 6364690.0);
         glm::dvec3 direction{0.374077, 0.71839, -0.5865};
@@ -1057,11 +1038,11 @@ namespace
     }
 }
 
-int main(int /*argc*/, char** /*argv*/)
+int main(const int argc, char** argv)
 {
     try
     {
-        run();
+        run(get_base_url(argc, argv));
         return 0;
     }
     catch (std::exception& e)
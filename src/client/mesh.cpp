@@ -7,20 +7,39 @@
 
 namespace
 {
-    void create_mesh_texture(const mesh_data& mesh)
+    void upload_texture_level(const texture_format format, const GLint level, const int width, const int height,
+                              const std::vector<uint8_t>& data)
     {
-        switch (mesh.format)
+        switch (format)
         {
         case texture_format::rgb:
-            glTexImage2D(GL_TEXTURE_2D, 0, GL_RGB, mesh.texture_width, mesh.texture_height, 0, GL_RGB, GL_UNSIGNED_BYTE,
-                         mesh.texture.data());
+            glTexImage2D(GL_TEXTURE_2D, level, GL_RGB, width, height, 0, GL_RGB, GL_UNSIGNED_BYTE, data.data());
             break;
         case texture_format::dxt1:
-            glCompressedTexImage2D(GL_TEXTURE_2D, 0, GL_COMPRESSED_RGB_S3TC_DXT1_EXT, mesh.texture_width, mesh.texture_height, 0,
-                                   static_cast<GLsizei>(mesh.texture.size()), mesh.texture.data());
+            glCompressedTexImage2D(GL_TEXTURE_2D, level, GL_COMPRESSED_RGB_S3TC_DXT1_EXT, width, height, 0,
+                                   static_cast<GLsizei>(data.size()), data.data());
             break;
         }
     }
+
+    void create_mesh_texture(const mesh_data& mesh)
+    {
+        auto width = mesh.texture_width;
+        auto height = mesh.texture_height;
+
+        upload_texture_level(mesh.format, 0, width, height, mesh.texture);
+
+        for (size_t i = 0; i < mesh.texture_mips.size(); ++i)
+        {
+            width = std::max(1, width / 2);
+            height = std::max(1, height / 2);
+
+            upload_texture_level(mesh.format, static_cast<GLint>(i + 1), width, height, mesh.texture_mips[i]);
+        }
+
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAX_LEVEL, static_cast<GLint>(mesh.texture_mips.size()));
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, mesh.texture_mips.empty() ? GL_LINEAR : GL_LINEAR_MIPMAP_LINEAR);
+    }
 }
 
 mesh::mesh(const mesh_data& mesh_data)
@@ -35,7 +54,8 @@ void mesh::unbuffer()
 
 void mesh::buffer(gl_bufferer& bufferer, const shader_context& ctx)
 {
-    if (!this->buffered_mesh_)
+    // Meshes whose texture failed to decode are not drawn
+    if (!this->buffered_mesh_ && !this->mesh_data_->texture.empty())
     {
         this->buffered_mesh_.emplace(bufferer, ctx, *this->mesh_data_);
     }
@@ -62,7 +82,6 @@ mesh_buffers::mesh_buffers(gl_bufferer& bufferer, const shader_context& ctx, con
     this->texture_buffer_ = bufferer.create_texture();
     glBindTexture(GL_TEXTURE_2D, this->texture_buffer_);
 
-    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
     glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
 
     glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
@@ -106,8 +125,13 @@ void mesh_buffers::ensure_vao_existance(const shader_context& ctx) const
     glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, this->index_buffer_);
 }
 
-void mesh_buffers::draw(const mesh_data& mesh, const shader_context& ctx) const
+void mesh_buffers::draw(const mesh_data& mesh, const shader_context& ctx, const uint8_t visible_octants) const
 {
+    if (!visible_octants)
+    {
+        return;
+    }
+
     this->ensure_vao_existance(ctx);
 
     scoped_vao _{this->vao_};
@@ -116,5 +140,36 @@ void mesh_buffers::draw(const mesh_data& mesh, const shader_context& ctx) const
     glUniform2fv(ctx.uv_scale_loc, 1, &mesh.uv_scale[0]);
 
     glBindTexture(GL_TEXTURE_2D, this->texture_buffer_);
-    glDrawElements(GL_TRIANGLE_STRIP, static_cast<GLsizei>(mesh.indices.size()), GL_UNSIGNED_SHORT, nullptr);
+
+    const auto draw_range = [](const index_range& range) {
+        if (range.count > 0)
+        {
+            glDrawElements(GL_TRIANGLES, static_cast<GLsizei>(range.count), GL_UNSIGNED_SHORT,
+                           reinterpret_cast<void*>(static_cast<uintptr_t>(range.offset) * sizeof(uint16_t)));
+        }
+    };
+
+    // Octant ranges are stored back to back, so adjacent visible octants merge into one draw call
+    index_range current{};
+
+    for (size_t i = 0; i < mesh.octant_ranges.size(); ++i)
+    {
+        const auto& range = mesh.octant_ranges[i];
+
+        if (!(visible_octants & (1 << i)))
+        {
+            draw_range(current);
+            current = {};
+            continue;
+        }
+
+        if (current.count == 0)
+        {
+            current.offset = range.offset;
+        }
+
+        current.count += range.count;
+    }
+
+    draw_range(current);
 }
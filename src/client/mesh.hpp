@@ -1,53 +1,14 @@
 #pragma once
 #include "shader_context.hpp"
 #include "gl_objects.hpp"
-
-enum class texture_format : int
-{
-    rgb,
-    dxt1,
-};
-
-template <typename T>
-struct vec3
-{
-    T x{};
-    T y{};
-    T z{};
-};
-
-#pragma pack(push, 1)
-struct vertex
-{
-    vec3<uint8_t> position{};
-    vec3<uint8_t> normal{0x7F, 0x7F, 0x7F};
-    uint8_t octant_mask{}; // octant mask
-    uint16_t u{};
-    uint16_t v{};
-};
-#pragma pack(pop)
-
-static_assert((sizeof(vertex) == 11), "vertex size must be 8");
-
-struct mesh_data
-{
-    glm::vec2 uv_offset{};
-    glm::vec2 uv_scale{};
-
-    std::vector<vertex> vertices{};
-    std::vector<uint16_t> indices{};
-    std::vector<uint8_t> texture{};
-    texture_format format{};
-    int texture_width{};
-    int texture_height{};
-};
+#include "mesh_data.hpp"
 
 class mesh_buffers
 {
   public:
     mesh_buffers(gl_bufferer& bufferer, const shader_context& ctx, const mesh_data& mesh);
 
-    void draw(const mesh_data& mesh, const shader_context& ctx) const;
+    void draw(const mesh_data& mesh, const shader_context& ctx, uint8_t visible_octants) const;
 
   private:
     mutable gl_object vao_{};
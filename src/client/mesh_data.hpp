@@ -0,0 +1,73 @@
+#pragma once
+
+enum class texture_format : int
+{
+    rgb,
+    dxt1,
+};
+
+template <typename T>
+struct vec3
+{
+    T x{};
+    T y{};
+    T z{};
+};
+
+#pragma pack(push, 1)
+struct vertex
+{
+    vec3<uint8_t> position{};
+    vec3<uint8_t> normal{0x7F, 0x7F, 0x7F};
+    uint8_t octant_mask{}; // octant mask
+    uint16_t u{};
+    uint16_t v{};
+};
+#pragma pack(pop)
+
+static_assert((sizeof(vertex) == 11), "vertex size must be 8");
+
+struct index_range
+{
+    uint32_t offset{};
+    uint32_t count{};
+};
+
+constexpr size_t octant_count = 8;
+
+enum class texture_encoding : int
+{
+    jpeg,
+    crn_dxt1,
+    dxt1_mips, // DXT1 levels back to back, level 0 first. Only the decoded cache stores these.
+};
+
+// The texture as it came with the tile, a small fraction of its decoded size. Tiles from the decoded cache
+// bring the DXT1 chain of their last upload instead, larger than the JPEG but ready for the GPU.
+struct encoded_texture
+{
+    texture_encoding encoding{};
+    std::span<const uint8_t> data{};
+    int width{};
+    int height{};
+    int scale_shift{}; // see jpeg_decoder::decode
+};
+
+struct mesh_data
+{
+    glm::vec2 uv_offset{};
+    glm::vec2 uv_scale{};
+
+    // Vertices, indices and the source texture live in the payload block of the node that owns the mesh
+    std::span<const vertex> vertices{};
+    std::span<const uint16_t> indices{}; // triangle list, sorted by octant
+    std::array<index_range, octant_count> octant_ranges{};
+    encoded_texture source_texture{};
+
+    // Decoded from source_texture right before the upload and released once it lives on the GPU
+    std::vector<uint8_t> texture{};
+    std::vector<std::vector<uint8_t>> texture_mips{}; // levels 1..n
+    texture_format format{};
+    int texture_width{};
+    int texture_height{};
+};
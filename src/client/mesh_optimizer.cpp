@@ -0,0 +1,376 @@
+#include <std_include.hpp>
+
+#include "mesh_optimizer.hpp"
+
+namespace mesh_optimizer
+{
+    namespace
+    {
+        constexpr size_t fifo_cache_size = 16;
+
+        constexpr size_t cache_size = 32;
+        constexpr size_t max_valence = 32;
+        constexpr uint32_t invalid_triangle = std::numeric_limits<uint32_t>::max();
+
+        constexpr float cache_decay_power = 1.5f;
+        constexpr float last_triangle_score = 0.75f;
+        constexpr float valence_boost_scale = 2.0f;
+        constexpr float valence_boost_power = 0.5f;
+
+        struct score_tables
+        {
+            std::array<float, cache_size> cache{};
+            std::array<float, max_valence> valence{};
+        };
+
+        score_tables build_score_tables()
+        {
+            score_tables tables{};
+
+            for (size_t i = 0; i < cache_size; ++i)
+            {
+                if (i < 3)
+                {
+                    tables.cache[i] = last_triangle_score;
+                }
+                else
+                {
+                    const auto scaler = 1.0f / static_cast<float>(cache_size - 3);
+                    tables.cache[i] = std::pow(1.0f - static_cast<float>(i - 3) * scaler, cache_decay_power);
+                }
+            }
+
+            for (size_t i = 1; i < max_valence; ++i)
+            {
+                tables.valence[i] = valence_boost_scale * std::pow(static_cast<float>(i), -valence_boost_power);
+            }
+
+            return tables;
+        }
+
+        const score_tables& get_score_tables()
+        {
+            static const auto tables = build_score_tables();
+            return tables;
+        }
+
+        float get_vertex_score(const int32_t cache_position, const uint32_t live_triangles)
+        {
+            if (live_triangles == 0)
+            {
+                return -1.0f;
+            }
+
+            const auto& tables = get_score_tables();
+
+            auto score = 0.0f;
+            if (cache_position >= 0)
+            {
+                score += tables.cache[static_cast<size_t>(cache_position)];
+            }
+
+            return score + tables.valence[std::min<size_t>(live_triangles, max_valence - 1)];
+        }
+
+        bool is_degenerate(const uint16_t a, const uint16_t b, const uint16_t c)
+        {
+            return a == b || b == c || a == c;
+        }
+
+        // Rotates the triangle so its smallest index comes first, which keeps the winding intact
+        uint64_t get_triangle_key(const uint16_t a, const uint16_t b, const uint16_t c)
+        {
+            uint16_t r[3] = {a, b, c};
+            if (b < a && b < c)
+            {
+                r[0] = b;
+                r[1] = c;
+                r[2] = a;
+            }
+            else if (c < a && c < b)
+            {
+                r[0] = c;
+                r[1] = a;
+                r[2] = b;
+            }
+
+            return static_cast<uint64_t>(r[0]) | (static_cast<uint64_t>(r[1]) << 16) | (static_cast<uint64_t>(r[2]) << 32);
+        }
+    }
+
+    float compute_acmr(const std::span<const uint16_t> indices, const size_t triangle_count)
+    {
+        if (triangle_count == 0)
+        {
+            return 0.0f;
+        }
+
+        std::array<uint16_t, fifo_cache_size> cache{};
+        size_t cache_entries = 0;
+        size_t cache_head = 0;
+        size_t misses = 0;
+
+        for (const auto index : indices)
+        {
+            const auto end = cache.begin() + static_cast<ptrdiff_t>(cache_entries);
+            if (std::find(cache.begin(), end, index) != end)
+            {
+                continue;
+            }
+
+            ++misses;
+
+            cache[cache_head] = index;
+            cache_head = (cache_head + 1) % cache.size();
+            cache_entries = std::min(cache_entries + 1, cache.size());
+        }
+
+        return static_cast<float>(misses) / static_cast<float>(triangle_count);
+    }
+
+    size_t count_strip_triangles(const std::span<const uint16_t> strip)
+    {
+        size_t triangles = 0;
+
+        for (size_t i = 2; i < strip.size(); ++i)
+        {
+            if (!is_degenerate(strip[i - 2], strip[i - 1], strip[i]))
+            {
+                ++triangles;
+            }
+        }
+
+        return triangles;
+    }
+
+    std::vector<uint16_t> triangulate_strip(const std::span<const uint16_t> strip, const size_t vertex_count)
+    {
+        std::vector<uint16_t> triangles{};
+        if (strip.size() < 3)
+        {
+            return triangles;
+        }
+
+        triangles.reserve((strip.size() - 2) * 3);
+
+        std::unordered_set<uint64_t> emitted{};
+        emitted.reserve(strip.size());
+
+        for (size_t i = 2; i < strip.size(); ++i)
+        {
+            auto a = strip[i - 2];
+            auto b = strip[i - 1];
+            const auto c = strip[i];
+
+            if (is_degenerate(a, b, c) || a >= vertex_count || b >= vertex_count || c >= vertex_count)
+            {
+                continue;
+            }
+
+            // Every odd triangle of a strip has flipped winding
+            if (i & 1)
+            {
+                std::swap(a, b);
+            }
+
+            if (!emitted.emplace(get_triangle_key(a, b, c)).second)
+            {
+                continue;
+            }
+
+            triangles.push_back(a);
+            triangles.push_back(b);
+            triangles.push_back(c);
+        }
+
+        triangles.shrink_to_fit();
+        return triangles;
+    }
+
+    void optimize_vertex_cache(const std::span<uint16_t> indices, const size_t vertex_count)
+    {
+        const auto triangle_count = indices.size() / 3;
+        if (triangle_count < 2 || vertex_count == 0)
+        {
+            return;
+        }
+
+        struct vertex_data
+        {
+            float score{};
+            int32_t cache_position{-1};
+            uint32_t live_triangles{};
+            uint32_t adjacency_offset{};
+        };
+
+        std::vector<vertex_data> vertices(vertex_count);
+
+        for (const auto index : indices)
+        {
+            if (index >= vertex_count)
+            {
+                return;
+            }
+
+            ++vertices[index].live_triangles;
+        }
+
+        uint32_t offset = 0;
+        for (auto& v : vertices)
+        {
+            v.adjacency_offset = offset;
+            offset += v.live_triangles;
+            v.live_triangles = 0;
+        }
+
+        std::vector<uint32_t> adjacency(indices.size());
+        for (size_t t = 0; t < triangle_count; ++t)
+        {
+            for (size_t k = 0; k < 3; ++k)
+            {
+                auto& v = vertices[indices[t * 3 + k]];
+                adjacency[v.adjacency_offset + v.live_triangles++] = static_cast<uint32_t>(t);
+            }
+        }
+
+        for (auto& v : vertices)
+        {
+            v.score = get_vertex_score(v.cache_position, v.live_triangles);
+        }
+
+        std::vector<float> triangle_scores(triangle_count);
+        std::vector<bool> emitted(triangle_count, false);
+
+        auto best_triangle = invalid_triangle;
+        auto best_score = -1.0f;
+
+        for (size_t t = 0; t < triangle_count; ++t)
+        {
+            const auto score = vertices[indices[t * 3 + 0]].score + //
+                               vertices[indices[t * 3 + 1]].score + //
+                               vertices[indices[t * 3 + 2]].score;
+
+            triangle_scores[t] = score;
+
+            if (score > best_score)
+            {
+                best_score = score;
+                best_triangle = static_cast<uint32_t>(t);
+            }
+        }
+
+        std::vector<uint16_t> output{};
+        output.reserve(indices.size());
+
+        std::array<uint16_t, cache_size + 3> cache{};
+        std::array<uint16_t, cache_size + 3> new_cache{};
+        size_t cache_entries = 0;
+
+        size_t scan_position = 0;
+
+        while (output.size() < indices.size())
+        {
+            if (best_triangle == invalid_triangle)
+            {
+                while (scan_position < triangle_count && emitted[scan_position])
+                {
+                    ++scan_position;
+                }
+
+                if (scan_position >= triangle_count)
+                {
+                    break;
+                }
+
+                best_triangle = static_cast<uint32_t>(scan_position);
+            }
+
+            const auto* triangle = &indices[best_triangle * 3];
+            emitted[best_triangle] = true;
+
+            size_t new_entries = 0;
+
+            for (size_t k = 0; k < 3; ++k)
+            {
+                const auto index = triangle[k];
+                output.push_back(index);
+                new_cache[new_entries++] = index;
+
+                auto& v = vertices[index];
+                const auto begin = adjacency.begin() + v.adjacency_offset;
+                const auto end = begin + v.live_triangles;
+                const auto entry = std::find(begin, end, best_triangle);
+                if (entry != end)
+                {
+                    std::iter_swap(entry, end - 1);
+                    --v.live_triangles;
+                }
+            }
+
+            for (size_t i = 0; i < cache_entries; ++i)
+            {
+                const auto index = cache[i];
+                if (index != triangle[0] && index != triangle[1] && index != triangle[2])
+                {
+                    new_cache[new_entries++] = index;
+                }
+            }
+
+            std::swap(cache, new_cache);
+            cache_entries = std::min(new_entries, cache.size());
+
+            best_triangle = invalid_triangle;
+            best_score = -1.0f;
+
+            for (size_t i = 0; i < cache_entries; ++i)
+            {
+                auto& v = vertices[cache[i]];
+                v.cache_position = i < cache_size ? static_cast<int32_t>(i) : -1;
+
+                const auto new_score = get_vertex_score(v.cache_position, v.live_triangles);
+                const auto delta = new_score - v.score;
+                v.score = new_score;
+
+                for (uint32_t j = 0; j < v.live_triangles; ++j)
+                {
+                    const auto t = adjacency[v.adjacency_offset + j];
+                    triangle_scores[t] += delta;
+
+                    if (triangle_scores[t] > best_score)
+                    {
+                        best_score = triangle_scores[t];
+                        best_triangle = t;
+                    }
+                }
+            }
+
+            cache_entries = std::min(cache_entries, cache_size);
+        }
+
+        std::ranges::copy(output, indices.begin());
+    }
+
+    void optimize_vertex_fetch(const std::span<uint16_t> indices, std::vector<vertex>& vertices)
+    {
+        constexpr auto unmapped = std::numeric_limits<uint32_t>::max();
+
+        std::vector<uint32_t> remap(vertices.size(), unmapped);
+        std::vector<vertex> new_vertices{};
+        new_vertices.reserve(vertices.size());
+
+        for (auto& index : indices)
+        {
+            auto& mapped = remap[index];
+            if (mapped == unmapped)
+            {
+                mapped = static_cast<uint32_t>(new_vertices.size());
+                new_vertices.push_back(vertices[index]);
+            }
+
+            index = static_cast<uint16_t>(mapped);
+        }
+
+        new_vertices.shrink_to_fit();
+        vertices = std::move(new_vertices);
+    }
+}
@@ -0,0 +1,20 @@
+#pragma once
+
+#include "mesh_data.hpp"
+
+namespace mesh_optimizer
+{
+    // Average cache miss ratio: transformed vertices per triangle for a 16 entry FIFO post-transform cache
+    float compute_acmr(std::span<const uint16_t> indices, size_t triangle_count);
+
+    size_t count_strip_triangles(std::span<const uint16_t> strip);
+
+    // Expands a strip into a list, dropping degenerate, duplicate and out of range triangles while keeping the winding
+    std::vector<uint16_t> triangulate_strip(std::span<const uint16_t> strip, size_t vertex_count);
+
+    // Reorders the triangles of a list for post-transform cache reuse (Forsyth)
+    void optimize_vertex_cache(std::span<uint16_t> indices, size_t vertex_count);
+
+    // Reorders vertices in order of first use and drops unreferenced ones, indices must be in range
+    void optimize_vertex_fetch(std::span<uint16_t> indices, std::vector<vertex>& vertices);
+}
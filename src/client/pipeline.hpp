@@ -0,0 +1,225 @@
+#pragma once
+
+#include <coroutine>
+
+#include "task_manager.hpp"
+
+// Objects move through their fetch, decode and upload stages as one coroutine. Every co_await hands the coroutine to the
+// executor of the next stage, the frame is the only allocation and it lives until the last stage is done.
+namespace pipeline
+{
+    using clock = std::chrono::steady_clock;
+
+    // Fire and forget, runs right away up to the first co_await and frees its frame when it returns
+    class job
+    {
+      public:
+        struct promise_type
+        {
+            job get_return_object() noexcept
+            {
+                return {};
+            }
+
+            std::suspend_never initial_suspend() noexcept
+            {
+                return {};
+            }
+
+            std::suspend_never final_suspend() noexcept
+            {
+                return {};
+            }
+
+            void return_void() noexcept
+            {
+            }
+
+            // Nobody waits for a job, so it has to handle its errors itself
+            void unhandled_exception() noexcept
+            {
+                std::terminate();
+            }
+        };
+    };
+
+    enum class stage
+    {
+        queue,
+        cache,
+        download,
+        decode,
+        physics,
+        texture,
+        upload,
+        count,
+    };
+
+    inline const char* get_stage_name(const stage s)
+    {
+        switch (s)
+        {
+        case stage::queue:
+            return "queue";
+        case stage::cache:
+            return "cache";
+        case stage::download:
+            return "download";
+        case stage::decode:
+            return "decode";
+        case stage::physics:
+            return "physics";
+        case stage::texture:
+            return "texture";
+        case stage::upload:
+            return "upload";
+        default:
+            return "unknown";
+        }
+    }
+
+    // Moving average of the time objects spend in each stage, including the wait for its executor
+    class stats
+    {
+      public:
+        void record(const stage s, const clock::time_point start)
+        {
+            const auto duration = std::chrono::duration_cast<std::chrono::microseconds>(clock::now() - start).count();
+            const auto sample = static_cast<uint64_t>(std::max<int64_t>(0, duration));
+
+            // Racy read-modify-write is fine for a statistic
+            auto& average = this->averages_.at(static_cast<size_t>(s));
+            const auto value = average.load();
+            average = value - value / 16 + sample / 16;
+        }
+
+        std::chrono::microseconds get_average(const stage s) const
+        {
+            return std::chrono::microseconds{this->averages_.at(static_cast<size_t>(s)).load()};
+        }
+
+      private:
+        std::array<std::atomic_uint64_t, static_cast<size_t>(stage::count)> averages_{};
+    };
+
+    // Continues on a task manager worker. Yields false instead if the token was stopped while the coroutine was queued
+    // or the task manager is shutting down, the coroutine has to wrap up on its own then.
+    class resume_on
+    {
+      public:
+        resume_on(task_manager& manager, task_manager::task_options options = {})
+            : manager_(&manager),
+              options_(std::move(options))
+        {
+        }
+
+        bool await_ready() const noexcept
+        {
+            return false;
+        }
+
+        void await_suspend(const std::coroutine_handle<> handle)
+        {
+            this->options_.cancelled = [this, handle] {
+                this->cancelled_ = true;
+                handle.resume();
+            };
+
+            // The coroutine might run on a worker before this returns, nothing may touch the awaiter afterwards
+            this->manager_->schedule([handle] { handle.resume(); }, std::move(this->options_));
+        }
+
+        bool await_resume() const noexcept
+        {
+            return !this->cancelled_;
+        }
+
+      private:
+        task_manager* manager_{};
+        task_manager::task_options options_{};
+        bool cancelled_{false};
+    };
+
+    // Continues on whichever thread calls run(), stages that need a specific thread like the GL context use this
+    class queue_executor
+    {
+      public:
+        queue_executor() = default;
+
+        // Coroutines that never got to run only hold references, dropping them is safe
+        ~queue_executor()
+        {
+            auto& handles = this->handles_.get_raw();
+            while (!handles.empty())
+            {
+                handles.front().destroy();
+                handles.pop();
+            }
+        }
+
+        queue_executor(queue_executor&&) = delete;
+        queue_executor(const queue_executor&) = delete;
+        queue_executor& operator=(queue_executor&&) = delete;
+        queue_executor& operator=(const queue_executor&) = delete;
+
+        auto schedule()
+        {
+            struct awaiter
+            {
+                queue_executor* executor{};
+
+                bool await_ready() const noexcept
+                {
+                    return false;
+                }
+
+                void await_suspend(const std::coroutine_handle<> handle) const
+                {
+                    executor->handles_.access([handle](std::queue<std::coroutine_handle<>>& handles) {
+                        handles.push(handle); //
+                    });
+                }
+
+                void await_resume() const noexcept
+                {
+                }
+            };
+
+            return awaiter{this};
+        }
+
+        // Resumes what was queued so far, coroutines that queue themselves again wait for the next call
+        bool run()
+        {
+            std::queue<std::coroutine_handle<>> handles{};
+
+            this->handles_.access([&handles](std::queue<std::coroutine_handle<>>& queued) {
+                handles.swap(queued); //
+            });
+
+            if (handles.empty())
+            {
+                return false;
+            }
+
+            while (!handles.empty())
+            {
+                const auto handle = handles.front();
+                handles.pop();
+                handle.resume();
+            }
+
+            return true;
+        }
+
+        size_t size() const
+        {
+            return this->handles_.access<size_t>([](const std::queue<std::coroutine_handle<>>& handles) {
+                return handles.size(); //
+            });
+        }
+
+      private:
+        utils::concurrency::container<std::queue<std::coroutine_handle<>>> handles_{};
+    };
+}
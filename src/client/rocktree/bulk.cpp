@@ -1,18 +1,17 @@
-#include "../std_include.hpp"
+#include <std_include.hpp>
 
 #include "bulk.hpp"
 #include "node.hpp"
 #include "rocktree.hpp"
 
 #include "rocktree_proto.hpp"
+#include "wire_format.hpp"
 
 namespace
 {
-    oriented_bounding_box unpack_obb(const std::string& packed, const glm::vec3& head_node_center, const double meters_per_texel)
+    oriented_bounding_box unpack_obb(const wire_format::bytes packed, const glm::vec3& head_node_center, const double meters_per_texel)
     {
-        assert(packed.size() == 15);
-
-        const auto* data = reinterpret_cast<const uint8_t*>(packed.data());
+        const auto* data = packed.data();
 
         oriented_bounding_box obb{};
 
@@ -60,10 +59,10 @@ namespace
         int level{};
     };
 
-    node_data_path_and_flags unpack_path_and_flags(const NodeMetadata& node_meta)
+    node_data_path_and_flags unpack_path_and_flags(const wire_format::node_metadata_view& node_meta)
     {
         node_data_path_and_flags result{};
-        auto path_id = node_meta.path_and_flags();
+        auto path_id = node_meta.path_and_flags;
 
         result.level = static_cast<int>(1 + (path_id & 3));
         path_id >>= 2;
@@ -104,21 +103,27 @@ std::filesystem::path bulk::get_filepath() const
     return "BulkMetadata" / octant_path_to_directory(this->get_path().to_string()) / this->get_filename();
 }
 
-void bulk::populate(const std::optional<std::string>& data)
+void bulk::populate(const std::span<const uint8_t> data)
 {
-    BulkMetadata bulk_meta{};
-    if (!data || !bulk_meta.ParseFromString(*data))
+    const auto bulk_meta = wire_format::parse_bulk_metadata(data);
+    if (!bulk_meta)
     {
-        throw std::runtime_error{"Failed to fetch bulk"};
+        throw std::runtime_error{"Failed to parse bulk"};
     }
 
-    this->head_node_center[0] = bulk_meta.head_node_center(0);
-    this->head_node_center[1] = bulk_meta.head_node_center(1);
-    this->head_node_center[2] = bulk_meta.head_node_center(2);
+    this->head_node_center[0] = bulk_meta->head_node_center.get(0);
+    this->head_node_center[1] = bulk_meta->head_node_center.get(1);
+    this->head_node_center[2] = bulk_meta->head_node_center.get(2);
 
-    for (const auto& node_meta : bulk_meta.node_metadata())
+    for (const auto node_meta_bytes : bulk_meta->node_metadata)
     {
-        const auto aux = unpack_path_and_flags(node_meta);
+        const auto node_meta = wire_format::parse_node_metadata(node_meta_bytes);
+        if (!node_meta)
+        {
+            throw std::runtime_error{"Failed to parse node metadata"};
+        }
+
+        const auto aux = unpack_path_and_flags(*node_meta);
 
         const bool has_data = !(aux.flags & NodeMetadata_Flags_NODATA);
         const bool is_leaf = (aux.flags & NodeMetadata_Flags_LEAF);
@@ -128,19 +133,18 @@ void bulk::populate(const std::optional<std::string>& data)
 
         if (has_bulk)
         {
-            const auto epoch = node_meta.has_bulk_metadata_epoch() ? node_meta.bulk_metadata_epoch() : bulk_meta.head_node_key().epoch();
+            const auto epoch = node_meta->bulk_metadata_epoch.value_or(bulk_meta->head_node_epoch);
 
-            this->bulks[aux.path] =
-                this->allocate_object<bulk>(this->get_rocktree(), *this, static_bulk_data{epoch, this->get_path() + aux.path});
+            this->bulks[aux.path] = this->get_rocktree().allocate_bulk(*this, static_bulk_data{epoch, this->get_path() + aux.path});
         }
 
-        if (!has_nodes || !node_meta.has_oriented_bounding_box())
+        // The box is read in place, a truncated one would point past the payload
+        if (!has_nodes || !node_meta->oriented_bounding_box || node_meta->oriented_bounding_box->size() != 15)
         {
             continue;
         }
 
-        const auto available_formats = node_meta.has_available_texture_formats() ? node_meta.available_texture_formats()
-                                                                                 : bulk_meta.default_available_texture_formats();
+        const auto available_formats = node_meta->available_texture_formats.value_or(bulk_meta->default_available_texture_formats);
 
         auto texture_format = texture_format::dxt1;
         if (available_formats & (1 << (Texture_Format_JPG - 1)))
@@ -151,16 +155,16 @@ void bulk::populate(const std::optional<std::string>& data)
         std::optional<uint32_t> imagery_epoch{};
         if (use_imagery_epoch)
         {
-            imagery_epoch = node_meta.has_imagery_epoch() ? node_meta.imagery_epoch() : bulk_meta.default_imagery_epoch();
+            imagery_epoch = node_meta->imagery_epoch.value_or(bulk_meta->default_imagery_epoch);
         }
 
-        auto n = this->get_rocktree().allocate_node(*this, static_node_data{node_meta.has_epoch() ? node_meta.epoch() : this->sdata_.epoch,
+        auto n = this->get_rocktree().allocate_node(*this, static_node_data{node_meta->epoch.value_or(this->sdata_.epoch),
                                                                             this->get_path() + aux.path, texture_format,
                                                                             std::move(imagery_epoch), is_leaf});
 
         n->can_have_data = has_data;
-        n->meters_per_texel = node_meta.has_meters_per_texel() ? node_meta.meters_per_texel() : bulk_meta.meters_per_texel(aux.level - 1);
-        n->obb = unpack_obb(node_meta.oriented_bounding_box(), this->head_node_center, n->meters_per_texel);
+        n->meters_per_texel = node_meta->meters_per_texel.value_or(bulk_meta->meters_per_texel.get(static_cast<size_t>(aux.level - 1)));
+        n->obb = unpack_obb(*node_meta->oriented_bounding_box, this->head_node_center, n->meters_per_texel);
 
         this->nodes[aux.path] = std::move(n);
     }
@@ -34,6 +34,6 @@ class bulk final : public rocktree_object
     std::string get_filename() const;
     std::string get_url() const override;
     std::filesystem::path get_filepath() const override;
-    void populate(const std::optional<std::string>& data) override;
+    void populate(std::span<const uint8_t> data) override;
     void clear() override;
 };
@@ -12,6 +12,11 @@ class generic_object
         return true;
     }
 
+    // Called when the object started fetching, was marked for deletion or lost its parent. Whoever fetches reports the end.
+    virtual void on_state_changed()
+    {
+    }
+
   public:
     generic_object(const generic_object* parent)
         : parent_(parent)
@@ -30,6 +35,7 @@ class generic_object
         if (this->parent_ == &parent)
         {
             this->parent_ = nullptr;
+            this->on_state_changed();
         }
     }
 
@@ -77,14 +83,21 @@ class generic_object
     bool mark_for_deletion()
     {
         auto expected = state::fresh;
-        if (!this->is_in_final_state() && !this->state_.compare_exchange_strong(expected, state::deleting))
+        const auto is_final = this->is_in_final_state();
+        if (!is_final && !this->state_.compare_exchange_strong(expected, state::deleting))
         {
             this->source_.request_stop();
             return false;
         }
 
-        this->state_ = state::deleting;
+        const auto previous = is_final ? this->state_.exchange(state::deleting) : state::fresh;
         this->source_.request_stop();
+
+        if (previous != state::deleting)
+        {
+            this->on_state_changed();
+        }
+
         return true;
     }
 
@@ -108,6 +121,13 @@ class generic_object
 
     bool was_used_within(const std::chrono::milliseconds& normal, const std::chrono::milliseconds& fetching,
                          const std::chrono::milliseconds& failed) const
+    {
+        return std::chrono::steady_clock::now() < this->get_expiry(normal, fetching, failed);
+    }
+
+    // Point in time after which the object counts as unused, unless it gets used again
+    std::chrono::steady_clock::time_point get_expiry(const std::chrono::milliseconds& normal, const std::chrono::milliseconds& fetching,
+                                                     const std::chrono::milliseconds& failed) const
     {
         auto time = normal;
         const auto state = this->state_.load();
@@ -120,7 +140,7 @@ class generic_object
             time = fetching;
         }
 
-        return (std::chrono::steady_clock::now() - this->last_use_.load()) < time;
+        return this->last_use_.load() + time;
     }
 
   protected:
@@ -159,6 +179,8 @@ class generic_object
             return;
         }
 
+        this->on_state_changed();
+
         try
         {
             this->populate();
@@ -166,6 +188,7 @@ class generic_object
         catch (...)
         {
             this->finish_fetching(false);
+            this->on_state_changed();
         }
     }
 };
@@ -0,0 +1,185 @@
+#include <std_include.hpp>
+
+#include "io_engine.hpp"
+
+#include <utils/thread.hpp>
+
+io_engine::io_engine(tile_store& store, task_manager& manager, const size_t num_threads)
+    : store_(&store),
+      manager_(&manager)
+{
+    this->threads_.resize(num_threads);
+
+    for (auto& thread : this->threads_)
+    {
+        thread = utils::thread::create_named_thread("IO Engine", [this] {
+            this->work(); //
+        });
+    }
+}
+
+io_engine::~io_engine()
+{
+    this->stop();
+}
+
+void io_engine::read(std::string key, read_callback callback)
+{
+    auto is_queued = false;
+
+    {
+        std::lock_guard _{this->mutex_};
+
+        if (!this->stop_)
+        {
+            ++this->in_flight_;
+            this->reads_.push_back(read_request{std::move(key), std::move(callback), clock::now()});
+            is_queued = true;
+        }
+    }
+
+    // Nothing is read anymore once stopped, the reader still gets its answer
+    if (!is_queued)
+    {
+        callback(std::nullopt);
+        return;
+    }
+
+    this->condition_variable_.notify_one();
+}
+
+void io_engine::write(std::string key, utils::shared_buffer data)
+{
+    ++this->in_flight_;
+
+    {
+        std::lock_guard _{this->mutex_};
+        this->writes_.emplace_back(std::move(key), std::move(data));
+        this->write_times_.emplace_back(clock::now());
+    }
+
+    this->condition_variable_.notify_one();
+}
+
+void io_engine::stop()
+{
+    std::deque<read_request> reads{};
+
+    {
+        std::lock_guard _{this->mutex_};
+        this->stop_ = true;
+        reads.swap(this->reads_);
+    }
+
+    // Whoever waits for a read gets to clean up
+    this->in_flight_ -= reads.size();
+
+    for (auto& request : reads)
+    {
+        request.callback(std::nullopt);
+    }
+
+    this->condition_variable_.notify_all();
+
+    for (auto& thread : this->threads_)
+    {
+        if (thread.joinable())
+        {
+            thread.join();
+        }
+    }
+
+    // Pending writes are still persisted
+    std::unique_lock lock{this->mutex_};
+    this->flush_writes(lock);
+}
+
+size_t io_engine::get_in_flight() const
+{
+    return this->in_flight_;
+}
+
+std::chrono::microseconds io_engine::get_average_latency() const
+{
+    return std::chrono::microseconds(this->average_latency_.load());
+}
+
+void io_engine::work()
+{
+    while (true)
+    {
+        std::unique_lock lock{this->mutex_};
+        this->condition_variable_.wait(lock, [this] {
+            return this->stop_ || !this->reads_.empty() || !this->writes_.empty(); //
+        });
+
+        if (this->stop_)
+        {
+            break;
+        }
+
+        // Reads come first, a fetch is waiting for them
+        if (this->reads_.empty())
+        {
+            this->flush_writes(lock);
+            continue;
+        }
+
+        auto request = std::move(this->reads_.front());
+        this->reads_.pop_front();
+
+        lock.unlock();
+
+        auto data = this->store_->read(request.key);
+        this->record_latency(request.submitted);
+
+        // A stopped task manager still answers the reader, just without the data
+        auto& callback = request.callback;
+
+        this->manager_->schedule(
+            [callback, d = std::move(data)]() mutable {
+                callback(std::move(d)); //
+            },
+            task_manager::task_options{
+                .priority = 0,
+                .cancelled = [callback] { callback(std::nullopt); },
+            });
+
+        --this->in_flight_;
+    }
+}
+
+void io_engine::flush_writes(std::unique_lock<std::mutex>& lock)
+{
+    if (this->writes_.empty())
+    {
+        return;
+    }
+
+    auto writes = std::move(this->writes_);
+    auto write_times = std::move(this->write_times_);
+
+    this->writes_ = {};
+    this->write_times_ = {};
+
+    lock.unlock();
+
+    this->store_->write(writes);
+
+    for (const auto& submitted : write_times)
+    {
+        this->record_latency(submitted);
+    }
+
+    this->in_flight_ -= writes.size();
+}
+
+void io_engine::record_latency(const clock::time_point submitted)
+{
+    const auto latency = std::chrono::duration_cast<std::chrono::microseconds>(clock::now() - submitted).count();
+    const auto sample = static_cast<uint64_t>(std::max<int64_t>(0, latency));
+
+    // Racy read-modify-write is fine for a statistic
+    const auto average = this->average_latency_.load();
+    this->average_latency_ = average - average / 16 + sample / 16;
+}
@@ -0,0 +1,62 @@
+#pragma once
+
+#include "tile_store.hpp"
+#include "../task_manager.hpp"
+
+// Runs tile store I/O on dedicated threads, so disk stalls never occupy the decode pool.
+// Writes are batched, read completions are handed back to the task manager.
+class io_engine
+{
+  public:
+    static constexpr size_t default_thread_count = 2;
+
+    using read_callback = std::function<void(std::optional<utils::shared_buffer>)>;
+
+    io_engine(tile_store& store, task_manager& manager, size_t num_threads = default_thread_count);
+    ~io_engine();
+
+    io_engine(io_engine&&) = delete;
+    io_engine(const io_engine&) = delete;
+    io_engine& operator=(io_engine&&) = delete;
+    io_engine& operator=(const io_engine&) = delete;
+
+    // The callback runs exactly once, without data if the engine stopped before the read got to run
+    void read(std::string key, read_callback callback);
+    void write(std::string key, utils::shared_buffer data);
+
+    void stop();
+
+    size_t get_in_flight() const;
+    std::chrono::microseconds get_average_latency() const;
+
+  private:
+    using clock = std::chrono::steady_clock;
+
+    struct read_request
+    {
+        std::string key{};
+        read_callback callback{};
+        clock::time_point submitted{};
+    };
+
+    tile_store* store_{};
+    task_manager* manager_{};
+
+    bool stop_{false};
+
+    std::mutex mutex_{};
+    std::condition_variable condition_variable_{};
+
+    std::deque<read_request> reads_{};
+    std::vector<tile_store::write_request> writes_{};
+    std::vector<clock::time_point> write_times_{};
+
+    std::atomic_size_t in_flight_{0};
+    std::atomic_uint64_t average_latency_{0}; // microseconds, exponential moving average
+
+    std::vector<std::thread> threads_{};
+
+    void work();
+    void flush_writes(std::unique_lock<std::mutex>& lock);
+    void record_latency(clock::time_point submitted);
+};
@@ -0,0 +1,129 @@
+#include <std_include.hpp>
+
+#include "negative_cache.hpp"
+
+namespace
+{
+    struct backoff_policy
+    {
+        std::chrono::seconds initial{};
+        std::chrono::seconds max{};
+    };
+
+    backoff_policy get_backoff_policy(const negative_cache::failure_kind kind)
+    {
+        switch (kind)
+        {
+        case negative_cache::failure_kind::not_found:
+            return {60s, 1h};
+        case negative_cache::failure_kind::server_error:
+            return {5s, 5min};
+        case negative_cache::failure_kind::network:
+            return {2s, 1min};
+        default:
+            return {10s, 10min};
+        }
+    }
+
+    std::chrono::seconds get_backoff(const negative_cache::failure_kind kind, const uint32_t failures)
+    {
+        const auto policy = get_backoff_policy(kind);
+        const auto shift = std::min(failures, 16u) - 1;
+        return std::min<std::chrono::seconds>(policy.initial * (1 << shift), policy.max);
+    }
+}
+
+negative_cache::failure_kind negative_cache::classify(const long status)
+{
+    if (status == 404 || status == 410)
+    {
+        return failure_kind::not_found;
+    }
+
+    if (status == 429 || (status >= 500 && status < 600))
+    {
+        return failure_kind::server_error;
+    }
+
+    if (status == 0)
+    {
+        return failure_kind::network;
+    }
+
+    return failure_kind::other;
+}
+
+bool negative_cache::is_blocked(const std::string& url, const clock::time_point now)
+{
+    std::lock_guard _{this->mutex_};
+
+    const auto entry = this->entries_.find(url);
+    if (entry == this->entries_.end() || entry->second.retry_time <= now)
+    {
+        return false;
+    }
+
+    ++this->stats_.rejected;
+    return true;
+}
+
+void negative_cache::record_failure(const std::string& url, const long status, const clock::time_point now)
+{
+    const auto kind = classify(status);
+
+    std::lock_guard _{this->mutex_};
+
+    switch (kind)
+    {
+    case failure_kind::not_found:
+        ++this->stats_.not_found;
+        break;
+    case failure_kind::server_error:
+        ++this->stats_.server_errors;
+        break;
+    case failure_kind::network:
+        ++this->stats_.network_errors;
+        break;
+    default:
+        ++this->stats_.other_errors;
+        break;
+    }
+
+    if (this->entries_.size() >= max_entries)
+    {
+        this->prune(now);
+    }
+
+    auto& entry = this->entries_[url];
+    entry.failures = std::min(entry.failures + 1, 32u);
+    entry.retry_time = now + get_backoff(kind, entry.failures);
+}
+
+void negative_cache::record_success(const std::string& url)
+{
+    std::lock_guard _{this->mutex_};
+    this->entries_.erase(url);
+}
+
+negative_cache::stats negative_cache::get_stats() const
+{
+    std::lock_guard _{this->mutex_};
+
+    auto stats = this->stats_;
+    stats.entries = this->entries_.size();
+
+    return stats;
+}
+
+void negative_cache::prune(const clock::time_point now)
+{
+    std::erase_if(this->entries_, [now](const auto& entry) {
+        return entry.second.retry_time <= now; //
+    });
+
+    // Everything is still backing off, forget about all of it instead of growing without bound
+    if (this->entries_.size() >= max_entries)
+    {
+        this->entries_.clear();
+    }
+}
@@ -0,0 +1,52 @@
+#pragma once
+
+// Remembers failed fetches per URL, so missing or flaky tiles are not requested again right away.
+// Each consecutive failure doubles the time until the next attempt, up to a cap depending on the failure kind.
+class negative_cache
+{
+  public:
+    using clock = std::chrono::steady_clock;
+
+    enum class failure_kind
+    {
+        not_found,    // 404/410, the tile most likely does not exist
+        server_error, // 5xx and 429
+        network,      // no response at all
+        other,
+    };
+
+    struct stats
+    {
+        size_t entries{};
+        size_t not_found{};
+        size_t server_errors{};
+        size_t network_errors{};
+        size_t other_errors{};
+        size_t rejected{}; // fetches skipped because the URL was still backing off
+    };
+
+    static constexpr size_t max_entries = 100'000;
+
+    static failure_kind classify(long status);
+
+    // Returns true if the URL failed recently and should not be fetched yet
+    bool is_blocked(const std::string& url, clock::time_point now = clock::now());
+
+    void record_failure(const std::string& url, long status, clock::time_point now = clock::now());
+    void record_success(const std::string& url);
+
+    stats get_stats() const;
+
+  private:
+    struct entry
+    {
+        clock::time_point retry_time{};
+        uint32_t failures{};
+    };
+
+    mutable std::mutex mutex_{};
+    std::unordered_map<std::string, entry> entries_{};
+    stats stats_{};
+
+    void prune(clock::time_point now);
+};
@@ -1,28 +1,26 @@
-#include "../std_include.hpp"
+#include <std_include.hpp>
 
 #include "node.hpp"
 #include "bulk.hpp"
 #include "rocktree.hpp"
 
 #include "rocktree_proto.hpp"
+#include "wire_format.hpp"
 
-#pragma warning(push)
-#pragma warning(disable : 4100)
-#pragma warning(disable : 4127)
-#pragma warning(disable : 4244)
-#pragma warning(disable : 6262)
+#include "../jpeg_decoder.hpp"
+#include "../mesh_optimizer.hpp"
 
-#define STB_IMAGE_IMPLEMENTATION
-#include <stb_image.h>
-#include <crn.h>
+#include <utils/byte_buffer.hpp>
 
-#pragma warning(pop)
+#if defined(__AVX2__) || defined(__SSE4_1__)
+#include <immintrin.h>
+#endif
 
 namespace
 {
-    int unpack_var_int(const std::string& packed, int* index)
+    int unpack_var_int(const wire_format::bytes packed, int* index)
     {
-        const auto* data = reinterpret_cast<const uint8_t*>(packed.data());
+        const auto* data = packed.data();
         const auto size = packed.size();
 
         int c = 0, d = 1, e{};
@@ -41,16 +39,12 @@ namespace
         return c;
     }
 
-    std::vector<vertex> unpack_vertices(const std::string& packed)
+    void unpack_vertices_reference(const uint8_t* data, const size_t start, std::vector<vertex>& vertices, uint8_t x, uint8_t y,
+                                   uint8_t z)
     {
-        const auto count = packed.size() / 3;
-        const auto data = reinterpret_cast<const uint8_t*>(packed.data());
-
-        uint8_t x = 0, y = 0, z = 0;
-
-        auto vertices = std::vector<vertex>(count);
+        const auto count = vertices.size();
 
-        for (size_t i = 0; i < count; i++)
+        for (size_t i = start; i < count; i++)
         {
             x += data[count * 0 + i];
             y += data[count * 1 + i];
@@ -60,6 +54,167 @@ namespace
             vertices[i].position.y = y;
             vertices[i].position.z = z;
         }
+    }
+
+#if defined(__AVX2__) || defined(__SSE4_1__)
+    // Shuffle masks that scatter 16 planar x/y/z bytes into 16 interleaved vertices (11 registers)
+    struct vertex_interleave_table
+    {
+        static constexpr size_t registers = sizeof(vertex);
+
+        alignas(16) int8_t x[registers][16]{};
+        alignas(16) int8_t y[registers][16]{};
+        alignas(16) int8_t z[registers][16]{};
+        alignas(16) uint8_t defaults[registers][16]{};
+    };
+
+    static_assert(offsetof(vertex, position) == 0 && offsetof(vertex, normal) == 3 && offsetof(vertex, octant_mask) == 6);
+
+    constexpr vertex_interleave_table build_vertex_interleave_table()
+    {
+        vertex_interleave_table table{};
+
+        for (size_t i = 0; i < vertex_interleave_table::registers * 16; ++i)
+        {
+            const auto reg = i / 16;
+            const auto pos = i % 16;
+
+            const auto index = static_cast<int8_t>(i / sizeof(vertex));
+            const auto field = i % sizeof(vertex);
+
+            table.x[reg][pos] = field == 0 ? index : -128;
+            table.y[reg][pos] = field == 1 ? index : -128;
+            table.z[reg][pos] = field == 2 ? index : -128;
+            table.defaults[reg][pos] = (field >= 3 && field < 6) ? 0x7F : 0;
+        }
+
+        return table;
+    }
+
+    constexpr auto vertex_interleave = build_vertex_interleave_table();
+
+    __m128i load_table_row(const void* row)
+    {
+        return _mm_load_si128(static_cast<const __m128i*>(row));
+    }
+
+    void store_interleaved_vertices(vertex* out, const __m128i x, const __m128i y, const __m128i z)
+    {
+        auto* target = reinterpret_cast<uint8_t*>(out);
+
+        for (size_t i = 0; i < vertex_interleave_table::registers; ++i)
+        {
+            auto value = load_table_row(vertex_interleave.defaults[i]);
+            value = _mm_or_si128(value, _mm_shuffle_epi8(x, load_table_row(vertex_interleave.x[i])));
+            value = _mm_or_si128(value, _mm_shuffle_epi8(y, load_table_row(vertex_interleave.y[i])));
+            value = _mm_or_si128(value, _mm_shuffle_epi8(z, load_table_row(vertex_interleave.z[i])));
+
+            _mm_storeu_si128(reinterpret_cast<__m128i*>(target + i * 16), value);
+        }
+    }
+#endif
+
+#ifdef __AVX2__
+    __m256i prefix_sum_epi8(__m256i value, const __m256i carry)
+    {
+        value = _mm256_add_epi8(value, _mm256_slli_si256(value, 1));
+        value = _mm256_add_epi8(value, _mm256_slli_si256(value, 2));
+        value = _mm256_add_epi8(value, _mm256_slli_si256(value, 4));
+        value = _mm256_add_epi8(value, _mm256_slli_si256(value, 8));
+
+        // Carry the low lane total into the high lane
+        const auto low_total = _mm256_shuffle_epi8(value, _mm256_set1_epi8(15));
+        value = _mm256_add_epi8(value, _mm256_permute2x128_si256(low_total, low_total, 0x08));
+
+        return _mm256_add_epi8(value, carry);
+    }
+
+    __m256i broadcast_last_epi8(const __m256i value)
+    {
+        const auto high_total = _mm256_shuffle_epi8(value, _mm256_set1_epi8(15));
+        return _mm256_permute2x128_si256(high_total, high_total, 0x11);
+    }
+#elif defined(__SSE4_1__)
+    __m128i prefix_sum_epi8(__m128i value, const __m128i carry)
+    {
+        value = _mm_add_epi8(value, _mm_slli_si128(value, 1));
+        value = _mm_add_epi8(value, _mm_slli_si128(value, 2));
+        value = _mm_add_epi8(value, _mm_slli_si128(value, 4));
+        value = _mm_add_epi8(value, _mm_slli_si128(value, 8));
+        return _mm_add_epi8(value, carry);
+    }
+
+    __m128i broadcast_last_epi8(const __m128i value)
+    {
+        return _mm_shuffle_epi8(value, _mm_set1_epi8(15));
+    }
+#endif
+
+    std::vector<vertex> unpack_vertices(const wire_format::bytes packed)
+    {
+        const auto count = packed.size() / 3;
+        const auto data = packed.data();
+
+        auto vertices = std::vector<vertex>(count);
+
+        size_t i = 0;
+
+#ifdef __AVX2__
+        auto carry_x = _mm256_setzero_si256();
+        auto carry_y = _mm256_setzero_si256();
+        auto carry_z = _mm256_setzero_si256();
+
+        for (; i + 32 <= count; i += 32)
+        {
+            const auto x = prefix_sum_epi8(_mm256_loadu_si256(reinterpret_cast<const __m256i*>(data + count * 0 + i)), carry_x);
+            const auto y = prefix_sum_epi8(_mm256_loadu_si256(reinterpret_cast<const __m256i*>(data + count * 1 + i)), carry_y);
+            const auto z = prefix_sum_epi8(_mm256_loadu_si256(reinterpret_cast<const __m256i*>(data + count * 2 + i)), carry_z);
+
+            store_interleaved_vertices(&vertices[i + 0], _mm256_castsi256_si128(x), _mm256_castsi256_si128(y),
+                                       _mm256_castsi256_si128(z));
+            store_interleaved_vertices(&vertices[i + 16], _mm256_extracti128_si256(x, 1), _mm256_extracti128_si256(y, 1),
+                                       _mm256_extracti128_si256(z, 1));
+
+            carry_x = broadcast_last_epi8(x);
+            carry_y = broadcast_last_epi8(y);
+            carry_z = broadcast_last_epi8(z);
+        }
+
+        uint8_t x = static_cast<uint8_t>(_mm256_extract_epi8(carry_x, 0));
+        uint8_t y = static_cast<uint8_t>(_mm256_extract_epi8(carry_y, 0));
+        uint8_t z = static_cast<uint8_t>(_mm256_extract_epi8(carry_z, 0));
+#elif defined(__SSE4_1__)
+        auto carry_x = _mm_setzero_si128();
+        auto carry_y = _mm_setzero_si128();
+        auto carry_z = _mm_setzero_si128();
+
+        for (; i + 16 <= count; i += 16)
+        {
+            const auto x = prefix_sum_epi8(_mm_loadu_si128(reinterpret_cast<const __m128i*>(data + count * 0 + i)), carry_x);
+            const auto y = prefix_sum_epi8(_mm_loadu_si128(reinterpret_cast<const __m128i*>(data + count * 1 + i)), carry_y);
+            const auto z = prefix_sum_epi8(_mm_loadu_si128(reinterpret_cast<const __m128i*>(data + count * 2 + i)), carry_z);
+
+            store_interleaved_vertices(&vertices[i], x, y, z);
+
+            carry_x = broadcast_last_epi8(x);
+            carry_y = broadcast_last_epi8(y);
+            carry_z = broadcast_last_epi8(z);
+        }
+
+        uint8_t x = static_cast<uint8_t>(_mm_extract_epi8(carry_x, 0));
+        uint8_t y = static_cast<uint8_t>(_mm_extract_epi8(carry_y, 0));
+        uint8_t z = static_cast<uint8_t>(_mm_extract_epi8(carry_z, 0));
+#else
+        uint8_t x = 0, y = 0, z = 0;
+#endif
+
+        unpack_vertices_reference(data, i, vertices, x, y, z);
+
+#ifndef NDEBUG
+        auto reference = std::vector<vertex>(count);
+        unpack_vertices_reference(data, 0, reference, 0, 0, 0);
+        assert(memcmp(vertices.data(), reference.data(), count * sizeof(vertex)) == 0);
+#endif
 
         return vertices;
     }
@@ -81,7 +236,7 @@ namespace
         return static_cast<uint8_t>(cr);
     }
 
-    int32_t transform_value(const int32_t v, const int32_t l)
+    constexpr int32_t transform_value(const int32_t v, const int32_t l)
     {
         if (4 >= l)
         {
@@ -97,122 +252,331 @@ namespace
         return -(v & 1);
     }
 
-    std::vector<uint8_t> unpack_for_normals(const NodeData& nodeData)
-    {
-        if (!nodeData.has_for_normals())
-        {
-            return {};
-        }
+    // Every shift above 6 decodes the same way, so there are only 8 distinct transforms
+    constexpr size_t normal_shift_classes = 8;
 
-        const auto& input = nodeData.for_normals();
-        if (input.size() <= 2)
-        {
-            return {};
-        }
+    using transform_table = std::array<std::array<int32_t, 256>, normal_shift_classes>;
 
-        const auto* data = reinterpret_cast<const uint8_t*>(input.data());
-        const size_t count = *reinterpret_cast<const uint16_t*>(data);
+    constexpr transform_table build_transform_table()
+    {
+        transform_table table{};
 
-        if (count * 2 != input.size() - 3)
+        for (size_t l = 0; l < table.size(); ++l)
         {
-            return {};
+            for (size_t v = 0; v < table[l].size(); ++v)
+            {
+                table[l][v] = transform_value(static_cast<int32_t>(v), static_cast<int32_t>(l));
+            }
         }
 
-        const int32_t s = data[2];
-        data += 3;
+        return table;
+    }
 
-        std::vector<uint8_t> output(count * 3);
+    constexpr auto transformed_values = build_transform_table();
 
-        for (size_t i = 0; i < count; i++)
-        {
-            double a = transform_value(data[0 + i], s) / 255.0;
-            const double f = transform_value(data[count + i], s) / 255.0;
+    // Packed as x | y << 8 | z << 16, so entries can be fetched with a single 32 bit gather
+    using packed_normal = uint32_t;
+    using normal_lookup = std::array<packed_normal, 256 * 256>;
 
-            double b = a, c = f, g = b + c, h = b - c;
-            int sign = 1;
+    packed_normal decode_normal(const int32_t a_value, const int32_t f_value)
+    {
+        double a = a_value / 255.0;
+        const double f = f_value / 255.0;
 
-            if (.5 > g || 1.5 < g || -.5 > h || .5 < h)
+        double b = a, c = f, g = b + c, h = b - c;
+        int sign = 1;
+
+        if (.5 > g || 1.5 < g || -.5 > h || .5 < h)
+        {
+            sign = -1;
+            if (.5 >= g)
+            {
+                b = .5 - f;
+                c = .5 - a;
+            }
+            else
             {
-                sign = -1;
-                if (.5 >= g)
+                if (1.5 <= g)
                 {
-                    b = .5 - f;
-                    c = .5 - a;
+                    b = 1.5 - f;
+                    c = 1.5 - a;
                 }
                 else
                 {
-                    if (1.5 <= g)
+                    if (-.5 >= h)
                     {
-                        b = 1.5 - f;
-                        c = 1.5 - a;
+                        b = f - .5;
+                        c = a + .5;
                     }
                     else
                     {
-                        if (-.5 >= h)
-                        {
-                            b = f - .5;
-                            c = a + .5;
-                        }
-                        else
-                        {
-                            b = f + .5;
-                            c = a - .5;
-                        }
+                        b = f + .5;
+                        c = a - .5;
                     }
                 }
+            }
 
-                g = b + c;
-                h = b - c;
+            g = b + c;
+            h = b - c;
+        }
+
+        a = fmin(fmin(2 * g - 1, 3 - 2 * g), fmin(2 * h + 1, 1 - 2 * h)) * sign;
+
+        b = 2 * b - 1;
+        c = 2 * c - 1;
+
+        const auto m = 127 / sqrt(a * a + b * b + c * c);
+
+        return static_cast<packed_normal>(double_to_uint8(m * a + 127)) |      //
+               static_cast<packed_normal>(double_to_uint8(m * b + 127)) << 8 | //
+               static_cast<packed_normal>(double_to_uint8(m * c + 127)) << 16;
+    }
+
+    const normal_lookup& get_normal_lookup(const int32_t shift)
+    {
+        static std::array<std::once_flag, normal_shift_classes> flags{};
+        static std::array<std::unique_ptr<normal_lookup>, normal_shift_classes> lookups{};
+
+        const auto index = static_cast<size_t>(std::clamp(shift, 0, static_cast<int32_t>(normal_shift_classes - 1)));
+
+        std::call_once(flags[index], [index] {
+            const auto& transform = transformed_values[index];
+            auto lookup = std::make_unique<normal_lookup>();
+
+            for (size_t a = 0; a < 256; ++a)
+            {
+                for (size_t f = 0; f < 256; ++f)
+                {
+                    (*lookup)[a | (f << 8)] = decode_normal(transform[a], transform[f]);
+                }
             }
 
-            a = fmin(fmin(2 * g - 1, 3 - 2 * g), fmin(2 * h + 1, 1 - 2 * h)) * sign;
+            lookups[index] = std::move(lookup);
+        });
+
+        return *lookups[index];
+    }
+
+    std::vector<packed_normal> unpack_for_normals(const wire_format::bytes input)
+    {
+        if (input.size() <= 2)
+        {
+            return {};
+        }
+
+        const auto* data = input.data();
+        const size_t count = *reinterpret_cast<const uint16_t*>(data);
+
+        if (count * 2 != input.size() - 3)
+        {
+            return {};
+        }
 
-            b = 2 * b - 1;
-            c = 2 * c - 1;
+        const auto& lookup = get_normal_lookup(data[2]);
+        data += 3;
 
-            const auto m = 127 / sqrt(a * a + b * b + c * c);
+        std::vector<packed_normal> output(count);
 
-            output[3 * i + 0] = double_to_uint8(m * a + 127);
-            output[3 * i + 1] = double_to_uint8(m * b + 127);
-            output[3 * i + 2] = double_to_uint8(m * c + 127);
+        for (size_t i = 0; i < count; i++)
+        {
+            output[i] = lookup[data[i] | (data[count + i] << 8)];
         }
 
         return output;
     }
 
-    void unpackNormals(const Mesh& mesh, std::vector<vertex>& vertices, const std::vector<uint8_t>& for_normals)
+    void store_normal(vertex& v, const packed_normal normal)
     {
-        if (!mesh.has_normals() || for_normals.empty())
+        v.normal.x = static_cast<uint8_t>(normal);
+        v.normal.y = static_cast<uint8_t>(normal >> 8);
+        v.normal.z = static_cast<uint8_t>(normal >> 16);
+    }
+
+    void unpackNormals(const wire_format::bytes normals, std::vector<vertex>& vertices, const std::vector<packed_normal>& for_normals)
+    {
+        if (normals.empty() || for_normals.empty())
         {
             return;
         }
 
         const auto count = vertices.size();
-        const auto& normals = mesh.normals();
-        const auto* input = reinterpret_cast<const uint8_t*>(normals.data());
+        const auto* input = normals.data();
 
         if (count * 2 != normals.size())
         {
             return;
         }
 
-        for (size_t i = 0; i < count; ++i)
+        size_t i = 0;
+
+#ifdef __AVX2__
+        const auto* table = reinterpret_cast<const int*>(for_normals.data());
+        const auto table_size = _mm256_set1_epi32(static_cast<int>(for_normals.size()));
+
+        for (; i + 8 <= count; i += 8)
+        {
+            const auto low = _mm256_cvtepu8_epi32(_mm_loadl_epi64(reinterpret_cast<const __m128i*>(input + i)));
+            const auto high = _mm256_cvtepu8_epi32(_mm_loadl_epi64(reinterpret_cast<const __m128i*>(input + count + i)));
+            const auto index = _mm256_or_si256(low, _mm256_slli_epi32(high, 8));
+
+            const auto valid = _mm256_cmpgt_epi32(table_size, index);
+            const auto gathered = _mm256_mask_i32gather_epi32(_mm256_setzero_si256(), table, index, valid, sizeof(packed_normal));
+
+            alignas(32) packed_normal result[8];
+            _mm256_store_si256(reinterpret_cast<__m256i*>(result), gathered);
+
+            const auto valid_mask = _mm256_movemask_ps(_mm256_castsi256_ps(valid));
+
+            for (size_t j = 0; j < 8; ++j)
+            {
+                if (valid_mask & (1 << j))
+                {
+                    store_normal(vertices[i + j], result[j]);
+                }
+            }
+        }
+#endif
+
+        for (; i < count; ++i)
         {
             const size_t j = input[i] + (input[count + i] << 8);
 
-            if (3 * j + 2 < for_normals.size())
+            if (j < for_normals.size())
             {
-                vertices[i].normal.x = for_normals[3 * j + 0];
-                vertices[i].normal.y = for_normals[3 * j + 1];
-                vertices[i].normal.z = for_normals[3 * j + 2];
+                store_normal(vertices[i], for_normals[j]);
             }
         }
     }
 
-    void unpack_tex_coords(const std::string& packed, std::vector<vertex>& vertices, glm::vec2& uv_offset, glm::vec2& uv_scale)
+    void unpack_tex_coords_reference(const uint8_t* data, const size_t start, std::vector<vertex>& vertices, const int u_mod,
+                                     const int v_mod, int u, int v)
     {
         const auto count = vertices.size();
-        auto data = reinterpret_cast<const uint8_t*>(packed.data());
+
+        for (size_t i = start; i < count; i++)
+        {
+            u = (u + data[count * 0 + i] + (data[count * 2 + i] << 8)) % u_mod;
+            v = (v + data[count * 1 + i] + (data[count * 3 + i] << 8)) % v_mod;
+
+            vertices[i].u = static_cast<uint16_t>(u);
+            vertices[i].v = static_cast<uint16_t>(v);
+        }
+    }
+
+#ifdef __AVX2__
+    constexpr size_t tex_coord_lanes = 8;
+    using tex_coord_register = __m256i;
+
+    tex_coord_register load_tex_coord_deltas(const uint8_t* low, const uint8_t* high)
+    {
+        const auto l = _mm256_cvtepu8_epi32(_mm_loadl_epi64(reinterpret_cast<const __m128i*>(low)));
+        const auto h = _mm256_cvtepu8_epi32(_mm_loadl_epi64(reinterpret_cast<const __m128i*>(high)));
+        return _mm256_or_si256(l, _mm256_slli_epi32(h, 8));
+    }
+
+    // Inclusive prefix sum modulo m, exact for sums below 2^22
+    tex_coord_register prefix_sum_mod_epi32(tex_coord_register value, const tex_coord_register carry, const tex_coord_register mod,
+                                            const __m256 inverse_mod)
+    {
+        value = _mm256_add_epi32(value, _mm256_slli_si256(value, 4));
+        value = _mm256_add_epi32(value, _mm256_slli_si256(value, 8));
+        value = _mm256_add_epi32(value, _mm256_blend_epi32(_mm256_setzero_si256(),
+                                                           _mm256_permutevar8x32_epi32(value, _mm256_set1_epi32(3)), 0xF0));
+        value = _mm256_add_epi32(value, carry);
+
+        const auto quotient = _mm256_cvttps_epi32(_mm256_mul_ps(_mm256_cvtepi32_ps(value), inverse_mod));
+        auto remainder = _mm256_sub_epi32(value, _mm256_mullo_epi32(quotient, mod));
+
+        remainder = _mm256_add_epi32(remainder, _mm256_and_si256(_mm256_cmpgt_epi32(_mm256_setzero_si256(), remainder), mod));
+        remainder = _mm256_sub_epi32(remainder, _mm256_andnot_si256(_mm256_cmpgt_epi32(mod, remainder), mod));
+
+        return remainder;
+    }
+
+    tex_coord_register broadcast_last_epi32(const tex_coord_register value)
+    {
+        return _mm256_permutevar8x32_epi32(value, _mm256_set1_epi32(7));
+    }
+
+    void store_tex_coords(vertex* out, const tex_coord_register u, const tex_coord_register v)
+    {
+        // Lane-wise pack keeps u0-3,v0-3,u4-7,v4-7 ordering, so interleave each 128 bit half
+        const auto packed = _mm256_packus_epi32(u, v);
+        const auto low = _mm256_castsi256_si128(packed);
+        const auto high = _mm256_extracti128_si256(packed, 1);
+
+        alignas(32) uint32_t uv[tex_coord_lanes];
+        _mm_store_si128(reinterpret_cast<__m128i*>(uv + 0), _mm_unpacklo_epi16(low, _mm_srli_si128(low, 8)));
+        _mm_store_si128(reinterpret_cast<__m128i*>(uv + 4), _mm_unpacklo_epi16(high, _mm_srli_si128(high, 8)));
+
+        for (size_t i = 0; i < tex_coord_lanes; ++i)
+        {
+            memcpy(&out[i].u, &uv[i], sizeof(uv[i]));
+        }
+    }
+
+    int extract_first_epi32(const tex_coord_register value)
+    {
+        return _mm256_cvtsi256_si32(value);
+    }
+#elif defined(__SSE4_1__)
+    constexpr size_t tex_coord_lanes = 4;
+    using tex_coord_register = __m128i;
+
+    tex_coord_register load_tex_coord_deltas(const uint8_t* low, const uint8_t* high)
+    {
+        int32_t l{}, h{};
+        memcpy(&l, low, sizeof(l));
+        memcpy(&h, high, sizeof(h));
+
+        return _mm_or_si128(_mm_cvtepu8_epi32(_mm_cvtsi32_si128(l)), _mm_slli_epi32(_mm_cvtepu8_epi32(_mm_cvtsi32_si128(h)), 8));
+    }
+
+    // Inclusive prefix sum modulo m, exact for sums below 2^22
+    tex_coord_register prefix_sum_mod_epi32(tex_coord_register value, const tex_coord_register carry, const tex_coord_register mod,
+                                            const __m128 inverse_mod)
+    {
+        value = _mm_add_epi32(value, _mm_slli_si128(value, 4));
+        value = _mm_add_epi32(value, _mm_slli_si128(value, 8));
+        value = _mm_add_epi32(value, carry);
+
+        const auto quotient = _mm_cvttps_epi32(_mm_mul_ps(_mm_cvtepi32_ps(value), inverse_mod));
+        auto remainder = _mm_sub_epi32(value, _mm_mullo_epi32(quotient, mod));
+
+        remainder = _mm_add_epi32(remainder, _mm_and_si128(_mm_cmplt_epi32(remainder, _mm_setzero_si128()), mod));
+        remainder = _mm_sub_epi32(remainder, _mm_andnot_si128(_mm_cmpgt_epi32(mod, remainder), mod));
+
+        return remainder;
+    }
+
+    tex_coord_register broadcast_last_epi32(const tex_coord_register value)
+    {
+        return _mm_shuffle_epi32(value, 0xFF);
+    }
+
+    void store_tex_coords(vertex* out, const tex_coord_register u, const tex_coord_register v)
+    {
+        const auto packed = _mm_packus_epi32(u, v);
+
+        alignas(16) uint32_t uv[tex_coord_lanes];
+        _mm_store_si128(reinterpret_cast<__m128i*>(uv), _mm_unpacklo_epi16(packed, _mm_srli_si128(packed, 8)));
+
+        for (size_t i = 0; i < tex_coord_lanes; ++i)
+        {
+            memcpy(&out[i].u, &uv[i], sizeof(uv[i]));
+        }
+    }
+
+    int extract_first_epi32(const tex_coord_register value)
+    {
+        return _mm_cvtsi128_si32(value);
+    }
+#endif
+
+    void unpack_tex_coords(const wire_format::bytes packed, std::vector<vertex>& vertices, glm::vec2& uv_offset, glm::vec2& uv_scale)
+    {
+        const auto count = vertices.size();
+        auto data = packed.data();
 
         if (packed.size() < 4 || count * 4 != packed.size() - 4)
         {
@@ -223,16 +587,52 @@ namespace
         const auto v_mod = 1 + *reinterpret_cast<const uint16_t*>(data + 2);
         data += 4;
 
+        size_t i = 0;
         auto u = 0, v = 0;
-        for (size_t i = 0; i < count; i++)
+
+#if defined(__AVX2__) || defined(__SSE4_1__)
+#ifdef __AVX2__
+        const auto u_mod_vec = _mm256_set1_epi32(u_mod);
+        const auto v_mod_vec = _mm256_set1_epi32(v_mod);
+        const auto u_inverse = _mm256_set1_ps(static_cast<float>(1.0 / u_mod));
+        const auto v_inverse = _mm256_set1_ps(static_cast<float>(1.0 / v_mod));
+        auto u_carry = _mm256_setzero_si256();
+        auto v_carry = _mm256_setzero_si256();
+#else
+        const auto u_mod_vec = _mm_set1_epi32(u_mod);
+        const auto v_mod_vec = _mm_set1_epi32(v_mod);
+        const auto u_inverse = _mm_set1_ps(static_cast<float>(1.0 / u_mod));
+        const auto v_inverse = _mm_set1_ps(static_cast<float>(1.0 / v_mod));
+        auto u_carry = _mm_setzero_si128();
+        auto v_carry = _mm_setzero_si128();
+#endif
+
+        for (; i + tex_coord_lanes <= count; i += tex_coord_lanes)
         {
-            u = (u + data[count * 0 + i] + (data[count * 2 + i] << 8)) % u_mod;
-            v = (v + data[count * 1 + i] + (data[count * 3 + i] << 8)) % v_mod;
+            const auto u_delta = load_tex_coord_deltas(data + count * 0 + i, data + count * 2 + i);
+            const auto v_delta = load_tex_coord_deltas(data + count * 1 + i, data + count * 3 + i);
 
-            vertices[i].u = static_cast<uint16_t>(u);
-            vertices[i].v = static_cast<uint16_t>(v);
+            const auto u_values = prefix_sum_mod_epi32(u_delta, u_carry, u_mod_vec, u_inverse);
+            const auto v_values = prefix_sum_mod_epi32(v_delta, v_carry, v_mod_vec, v_inverse);
+
+            store_tex_coords(&vertices[i], u_values, v_values);
+
+            u_carry = broadcast_last_epi32(u_values);
+            v_carry = broadcast_last_epi32(v_values);
         }
 
+        u = extract_first_epi32(u_carry);
+        v = extract_first_epi32(v_carry);
+#endif
+
+        unpack_tex_coords_reference(data, i, vertices, u_mod, v_mod, u, v);
+
+#ifndef NDEBUG
+        auto reference = vertices;
+        unpack_tex_coords_reference(data, 0, reference, u_mod, v_mod, 0, 0);
+        assert(memcmp(vertices.data(), reference.data(), count * sizeof(vertex)) == 0);
+#endif
+
         uv_offset[0] = 0.5;
         uv_offset[1] = 0.5;
 
@@ -240,13 +640,38 @@ namespace
         uv_scale[1] = static_cast<float>(1.0 / v_mod);
     }
 
-    std::vector<uint16_t> unpack_indices(const std::string& packed)
+    // Only overground and terrain are drawn, the water and overlay layers after them are never decoded
+    constexpr int drawn_layers = 3;
+    constexpr int octants_per_layer = 8;
+
+    // Number of strip indices that belong to the drawn layers, negative if the counts overflow
+    int get_drawn_index_count(const wire_format::bytes packed)
+    {
+        auto offset = 0;
+        const auto len = std::min(unpack_var_int(packed, &offset), drawn_layers * octants_per_layer);
+
+        int64_t count = 0;
+        for (auto i = 0; i < len; i++)
+        {
+            count += unpack_var_int(packed, &offset);
+        }
+
+        return count > std::numeric_limits<int>::max() ? -1 : static_cast<int>(count);
+    }
+
+    // Decodes the first max_count indices of the strip, the zero run-length state only depends on the preceding ones
+    std::optional<std::vector<uint16_t>> unpack_indices(const wire_format::bytes packed, const int max_count)
     {
         auto offset = 0;
 
         const auto triangle_strip_len = unpack_var_int(packed, &offset);
-        auto triangle_strip = std::vector<uint16_t>(triangle_strip_len);
-        for (int zeros = 0, c = 0, i = 0; i < triangle_strip_len; ++i)
+        if (max_count > triangle_strip_len)
+        {
+            return {};
+        }
+
+        auto triangle_strip = std::vector<uint16_t>(max_count);
+        for (int zeros = 0, c = 0, i = 0; i < max_count; ++i)
         {
             const int val = unpack_var_int(packed, &offset);
 
@@ -260,46 +685,371 @@ namespace
         return triangle_strip;
     }
 
-    void unpack_octant_mask_and_octant_counts_and_layer_bounds(const std::string& packed, const std::vector<uint16_t>& indices,
-                                                               std::vector<vertex>& vertices, int layer_bounds[10])
+    void unpack_octant_mask(const wire_format::bytes packed, const std::vector<uint16_t>& indices, std::vector<vertex>& vertices)
     {
-        // todo: octant counts
+        // Octant counts tag every vertex with its octant, triangles get grouped by it after triangulation.
+        // The indices end at the drawn layer bound, so the counts of the layers after it are never read.
         auto offset = 0;
         const auto len = unpack_var_int(packed, &offset);
-        auto idx_i = 0;
-        auto k = 0;
-        auto m = 0;
+        size_t idx_i = 0;
 
-        for (auto i = 0; i < len; i++)
+        for (auto i = 0; i < len && idx_i < indices.size(); i++)
         {
-            if (0 == i % 8)
+            const auto v = unpack_var_int(packed, &offset);
+            for (auto j = 0; j < v && idx_i < indices.size(); j++)
             {
-                if (m < 10)
+                const auto vtx_i = indices[idx_i++];
+                if (vtx_i < vertices.size())
                 {
-                    layer_bounds[m++] = k;
+                    vertices[vtx_i].octant_mask = i & 7;
                 }
             }
+        }
+    }
 
-            const auto v = unpack_var_int(packed, &offset);
-            for (auto j = 0; j < v; j++)
+    // Nodes are replaced by their children once a texel gets larger than a pixel, so a texture holding more texels
+    // than the node spans at its meters_per_texel is never sampled at full resolution
+    int get_texture_scale_shift(const node& n, const uint32_t texture_width, const uint32_t texture_height)
+    {
+        if (n.meters_per_texel <= 0.0f)
+        {
+            return 0;
+        }
+
+        const auto& extents = n.obb.extents;
+        const auto node_texels = 2.0 * std::max({extents.x, extents.y, extents.z}) / n.meters_per_texel;
+        const auto texture_size = std::max(texture_width, texture_height);
+
+        int shift = 0;
+        while (shift < jpeg_decoder::max_scale_shift && static_cast<double>(texture_size >> (shift + 1)) >= node_texels)
+        {
+            ++shift;
+        }
+
+        return shift;
+    }
+
+    // A mesh while it is decoded. The texture still points into the downloaded bytes, everything is copied into the
+    // payload block of the node once all meshes are done.
+    struct decoded_mesh
+    {
+        mesh_data data{};
+        std::vector<vertex> vertices{};
+        std::vector<uint16_t> indices{};
+    };
+
+    // Stable counting sort of the triangle list by the octant of each triangle's first vertex
+    void group_triangles_by_octant(decoded_mesh& m)
+    {
+        std::array<uint32_t, octant_count> counts{};
+        const auto triangle_count = m.indices.size() / 3;
+
+        for (size_t i = 0; i < triangle_count; ++i)
+        {
+            ++counts[m.vertices[m.indices[i * 3]].octant_mask & 7];
+        }
+
+        uint32_t offset = 0;
+        for (size_t i = 0; i < octant_count; ++i)
+        {
+            m.data.octant_ranges[i] = {offset, counts[i] * 3};
+            offset += counts[i] * 3;
+        }
+
+        std::array<uint32_t, octant_count> write_offsets{};
+        for (size_t i = 0; i < octant_count; ++i)
+        {
+            write_offsets[i] = m.data.octant_ranges[i].offset;
+        }
+
+        std::vector<uint16_t> sorted(m.indices.size());
+
+        for (size_t i = 0; i < triangle_count; ++i)
+        {
+            const auto* triangle = &m.indices[i * 3];
+            auto& write_offset = write_offsets[m.vertices[triangle[0]].octant_mask & 7];
+
+            memcpy(&sorted[write_offset], triangle, 3 * sizeof(uint16_t));
+            write_offset += 3;
+        }
+
+        m.indices = std::move(sorted);
+    }
+
+    vertex_cache_stats convert_to_triangle_list(decoded_mesh& m)
+    {
+        vertex_cache_stats stats{};
+
+        const auto strip_triangles = mesh_optimizer::count_strip_triangles(m.indices);
+        stats.strip_acmr = mesh_optimizer::compute_acmr(m.indices, strip_triangles);
+
+        m.indices = mesh_optimizer::triangulate_strip(m.indices, m.vertices.size());
+        group_triangles_by_octant(m);
+
+        // Octant ranges are drawn independently, so each one is optimized on its own
+        for (const auto& range : m.data.octant_ranges)
+        {
+            mesh_optimizer::optimize_vertex_cache(std::span(m.indices).subspan(range.offset, range.count), m.vertices.size());
+        }
+
+        mesh_optimizer::optimize_vertex_fetch(m.indices, m.vertices);
+
+        stats.triangles = m.indices.size() / 3;
+        stats.list_acmr = mesh_optimizer::compute_acmr(m.indices, stats.triangles);
+
+        return stats;
+    }
+
+    template <typename T>
+    std::span<const T> place_in_payload(uint8_t* payload, size_t& offset, const std::span<const T> source)
+    {
+        auto* destination = payload + offset;
+        if (!source.empty())
+        {
+            memcpy(destination, source.data(), source.size_bytes());
+        }
+
+        offset += source.size_bytes();
+        return {reinterpret_cast<const T*>(destination), source.size()};
+    }
+
+    // One block per node. All indices come first, which keeps them aligned, then all vertices, then the source textures.
+    void pack_meshes(node& n, std::vector<decoded_mesh>& meshes)
+    {
+        size_t size = 0;
+        for (const auto& m : meshes)
+        {
+            size += m.indices.size() * sizeof(uint16_t) + m.vertices.size() * sizeof(vertex) + m.data.source_texture.data.size();
+        }
+
+        n.payload_ = std::make_unique_for_overwrite<uint8_t[]>(size);
+        n.payload_size_ = size;
+
+        auto* payload = n.payload_.get();
+        size_t offset = 0;
+
+        for (auto& m : meshes)
+        {
+            m.data.indices = place_in_payload<uint16_t>(payload, offset, m.indices);
+        }
+
+        for (auto& m : meshes)
+        {
+            m.data.vertices = place_in_payload<vertex>(payload, offset, m.vertices);
+        }
+
+        n.meshes_.reserve(meshes.size());
+
+        for (auto& m : meshes)
+        {
+            m.data.source_texture.data = place_in_payload(payload, offset, m.data.source_texture.data);
+            n.meshes_.emplace_back(std::move(m.data));
+        }
+    }
+
+    // Bump whenever the layout or the output of the decode pipeline changes, stale files are then ignored
+    constexpr uint32_t decoded_cache_magic = 0x44524942; // BIRD
+    constexpr uint32_t decoded_cache_version = 5;
+
+    struct payload_range
+    {
+        uint32_t offset{};
+        uint32_t count{};
+    };
+
+    template <typename T>
+    std::span<const T> get_payload_span(const uint8_t* payload, const size_t payload_size, const payload_range& range)
+    {
+        if (range.offset % alignof(T) != 0 || range.offset > payload_size ||
+            static_cast<size_t>(range.count) * sizeof(T) > payload_size - range.offset)
+        {
+            throw std::runtime_error("Invalid payload range");
+        }
+
+        return {reinterpret_cast<const T*>(payload + range.offset), range.count};
+    }
+
+    // Collects the pieces of the payload block that is written to the cache, in the order they are added
+    class payload_writer
+    {
+      public:
+        template <typename T>
+        payload_range add(const std::span<const T> data)
+        {
+            const payload_range range{
+                .offset = static_cast<uint32_t>(this->size_),
+                .count = static_cast<uint32_t>(data.size()),
+            };
+
+            this->add_bytes(std::as_bytes(data));
+            return range;
+        }
+
+        // Consecutive pieces, one range of bytes
+        payload_range add_all(const std::vector<uint8_t>& first, const std::vector<std::vector<uint8_t>>& rest)
+        {
+            auto range = this->add(std::span<const uint8_t>(first));
+
+            for (const auto& piece : rest)
             {
-                const auto idx = indices[idx_i++];
-                if (idx < indices.size())
-                {
-                    const auto vtx_i = idx;
-                    if (vtx_i < vertices.size())
-                    {
-                        vertices[vtx_i].octant_mask = i & 7;
-                    }
-                }
+                range.count += this->add(std::span<const uint8_t>(piece)).count;
+            }
+
+            return range;
+        }
+
+        size_t get_size() const
+        {
+            return this->size_;
+        }
+
+        void write_to(utils::buffer_serializer& buffer) const
+        {
+            for (const auto& piece : this->pieces_)
+            {
+                buffer.write(piece.data(), piece.size());
             }
-            k += v;
         }
 
-        for (; 10 > m; m++)
+      private:
+        size_t size_{};
+        std::vector<std::span<const std::byte>> pieces_{};
+
+        void add_bytes(const std::span<const std::byte> data)
         {
-            layer_bounds[m] = k;
+            this->pieces_.emplace_back(data);
+            this->size_ += data.size();
         }
+    };
+
+    bool has_transcoded_texture(const mesh_data& m)
+    {
+        return m.format == texture_format::dxt1 && !m.texture.empty();
+    }
+
+    // Laid out like pack_meshes does it. A texture that was already transcoded is stored with its mip chain
+    // in place of the source, so a hit leaves nothing to decode.
+    std::string serialize_decoded_node(const node& n)
+    {
+        payload_writer payload{};
+
+        struct mesh_ranges
+        {
+            payload_range indices{};
+            payload_range vertices{};
+            payload_range texture{};
+        };
+
+        std::vector<mesh_ranges> ranges(n.meshes_.size());
+
+        for (size_t i = 0; i < n.meshes_.size(); ++i)
+        {
+            ranges[i].indices = payload.add(n.meshes_[i].indices);
+        }
+
+        for (size_t i = 0; i < n.meshes_.size(); ++i)
+        {
+            ranges[i].vertices = payload.add(n.meshes_[i].vertices);
+        }
+
+        for (size_t i = 0; i < n.meshes_.size(); ++i)
+        {
+            const auto& m = n.meshes_[i];
+            ranges[i].texture = has_transcoded_texture(m) ? payload.add_all(m.texture, m.texture_mips) : payload.add(m.source_texture.data);
+        }
+
+        utils::buffer_serializer buffer{};
+        buffer.write(decoded_cache_magic);
+        buffer.write(decoded_cache_version);
+        buffer.write(n.matrix_globe_from_mesh);
+        buffer.write(n.cache_stats_);
+        buffer.write(static_cast<uint32_t>(n.meshes_.size()));
+        buffer.write(static_cast<uint32_t>(payload.get_size()));
+
+        for (size_t i = 0; i < n.meshes_.size(); ++i)
+        {
+            const auto& m = n.meshes_[i];
+            const auto transcoded = has_transcoded_texture(m);
+
+            buffer.write(m.uv_offset);
+            buffer.write(m.uv_scale);
+            buffer.write(ranges[i].vertices);
+            buffer.write(ranges[i].indices);
+            buffer.write(m.octant_ranges);
+            buffer.write(transcoded ? texture_encoding::dxt1_mips : m.source_texture.encoding);
+            buffer.write(transcoded ? m.texture_width : m.source_texture.width);
+            buffer.write(transcoded ? m.texture_height : m.source_texture.height);
+            buffer.write(transcoded ? 0 : m.source_texture.scale_shift);
+            buffer.write(ranges[i].texture);
+        }
+
+        payload.write_to(buffer);
+
+        return buffer.move_buffer();
+    }
+
+    bool deserialize_decoded_node(node& n, const std::span<const uint8_t> data)
+    {
+        utils::buffer_deserializer buffer(data);
+        if (buffer.read<uint32_t>() != decoded_cache_magic || buffer.read<uint32_t>() != decoded_cache_version)
+        {
+            return false;
+        }
+
+        n.matrix_globe_from_mesh = buffer.read<glm::dmat4>();
+        n.cache_stats_ = buffer.read<vertex_cache_stats>();
+
+        const auto mesh_count = buffer.read<uint32_t>();
+        const auto payload_size = buffer.read<uint32_t>();
+
+        if (payload_size > buffer.get_remaining_size())
+        {
+            return false;
+        }
+
+        n.payload_ = std::make_unique_for_overwrite<uint8_t[]>(payload_size);
+        n.payload_size_ = payload_size;
+        n.meshes_.reserve(mesh_count);
+
+        const auto* payload = n.payload_.get();
+
+        for (uint32_t i = 0; i < mesh_count; ++i)
+        {
+            mesh_data m{};
+            m.uv_offset = buffer.read<glm::vec2>();
+            m.uv_scale = buffer.read<glm::vec2>();
+            m.vertices = get_payload_span<vertex>(payload, payload_size, buffer.read<payload_range>());
+            m.indices = get_payload_span<uint16_t>(payload, payload_size, buffer.read<payload_range>());
+            m.octant_ranges = buffer.read<decltype(m.octant_ranges)>();
+
+            // Drawn without further checks, a range past the indices would read foreign memory
+            for (const auto& range : m.octant_ranges)
+            {
+                if (range.offset > m.indices.size() || range.count > m.indices.size() - range.offset)
+                {
+                    throw std::runtime_error("Invalid octant range");
+                }
+            }
+
+            m.source_texture.encoding = buffer.read<texture_encoding>();
+            m.source_texture.width = buffer.read<int>();
+            m.source_texture.height = buffer.read<int>();
+            m.source_texture.scale_shift = buffer.read<int>();
+            m.source_texture.data = get_payload_span<uint8_t>(payload, payload_size, buffer.read<payload_range>());
+
+            // Stored by an earlier run, once is enough
+            if (m.source_texture.encoding == texture_encoding::dxt1_mips)
+            {
+                n.has_stored_textures_ = true;
+            }
+
+            n.vertices_ += m.vertices.size();
+            n.meshes_.emplace_back(std::move(m));
+        }
+
+        buffer.read(n.payload_.get(), payload_size);
+
+        return buffer.get_remaining_size() == 0;
     }
 }
 
@@ -340,108 +1090,165 @@ std::filesystem::path node::get_filepath() const
     return "NodeData" / octant_path_to_directory(this->sdata_.path.to_string()) / this->get_filename();
 }
 
-void node::populate(const std::optional<std::string>& data)
+void node::populate(const std::span<const uint8_t> data)
 {
-    NodeData node_data{};
-    if (!data || !node_data.ParseFromString(*data))
+    const auto node_data = wire_format::parse_node_data(data);
+    if (!node_data)
     {
-        throw std::runtime_error{"Failed to fetch node"};
+        throw std::runtime_error{"Failed to parse node"};
     }
 
-    if (node_data.matrix_globe_from_mesh_size() == 16)
+#ifndef NDEBUG
+    NodeData reference{};
+    const auto parsed = reference.ParseFromArray(data.data(), static_cast<int>(data.size()));
+    assert(parsed && static_cast<size_t>(reference.meshes_size()) == node_data->mesh_count);
+#endif
+
+    if (node_data->matrix_globe_from_mesh.size() == 16)
     {
         for (int i = 0; i < 4; ++i)
         {
             for (int j = 0; j < 4; ++j)
             {
-                this->matrix_globe_from_mesh[i][j] = node_data.matrix_globe_from_mesh(4 * i + j);
+                this->matrix_globe_from_mesh[i][j] = node_data->matrix_globe_from_mesh[4 * i + j];
             }
         }
     }
 
     this->vertices_ = 0;
-    this->meshes_.reserve(static_cast<size_t>(node_data.meshes_size()));
+    this->cache_stats_ = {};
 
-    for (const auto& mesh : node_data.meshes())
-    {
-        mesh_data m{};
+    std::vector<decoded_mesh> meshes{};
+    meshes.reserve(node_data->mesh_count);
 
-        m.indices = unpack_indices(mesh.indices());
-        m.vertices = unpack_vertices(mesh.vertices());
+    const auto for_normals = unpack_for_normals(node_data->for_normals);
 
-        const auto forNormals = unpack_for_normals(node_data);
-        unpackNormals(mesh, m.vertices, forNormals);
-        unpack_tex_coords(mesh.texture_coordinates(), m.vertices, m.uv_offset, m.uv_scale);
-        if (mesh.uv_offset_and_scale_size() == 4)
+    for (const auto mesh_bytes : node_data->meshes)
+    {
+        const auto mesh = wire_format::parse_mesh(mesh_bytes);
+        if (!mesh)
         {
-            m.uv_offset[0] = mesh.uv_offset_and_scale(0);
-            m.uv_offset[1] = mesh.uv_offset_and_scale(1);
-            m.uv_scale[0] = mesh.uv_offset_and_scale(2);
-            m.uv_scale[1] = mesh.uv_offset_and_scale(3);
+            throw std::runtime_error{"Failed to parse mesh"};
         }
 
-        int layer_bounds[10];
-        unpack_octant_mask_and_octant_counts_and_layer_bounds(mesh.layer_and_octant_counts(), m.indices, m.vertices, layer_bounds);
-        if (layer_bounds[3] < 0 || layer_bounds[3] > m.indices.size())
+        const auto index_count = get_drawn_index_count(mesh->layer_and_octant_counts);
+        if (index_count < 0)
         {
             continue;
         }
 
-        // m.indices_len = layer_bounds[3]; // enable
-        m.indices.resize(layer_bounds[3]);
-
-        auto textures = mesh.texture();
-        if (textures.size() != 1 || textures[0].data().size() != 1)
+        auto indices = unpack_indices(mesh->indices, index_count);
+        if (!indices)
         {
             continue;
         }
 
-        auto texture = textures[0];
-        auto tex = texture.data()[0];
+        decoded_mesh m{};
+
+        m.indices = std::move(*indices);
+        m.vertices = unpack_vertices(mesh->vertices);
+
+        unpackNormals(mesh->normals, m.vertices, for_normals);
+        unpack_tex_coords(mesh->texture_coordinates, m.vertices, m.data.uv_offset, m.data.uv_scale);
+        if (mesh->uv_offset_and_scale.size() == 4)
+        {
+            m.data.uv_offset[0] = mesh->uv_offset_and_scale[0];
+            m.data.uv_offset[1] = mesh->uv_offset_and_scale[1];
+            m.data.uv_scale[0] = mesh->uv_offset_and_scale[2];
+            m.data.uv_scale[1] = mesh->uv_offset_and_scale[3];
+        }
+
+        unpack_octant_mask(mesh->layer_and_octant_counts, m.indices, m.vertices);
 
-        // maybe: keep compressed in memory?
-        if (texture.format() == Texture_Format_JPG)
+        const auto& texture = mesh->texture;
+        if (mesh->texture_count != 1 || texture.data_count != 1)
         {
-            auto tex_data = reinterpret_cast<uint8_t*>(tex.data());
-            int width{}, height{}, comp{};
-            unsigned char* pixels = stbi_load_from_memory(&tex_data[0], static_cast<int>(tex.size()), &width, &height, &comp, 0);
-            if (!pixels)
-            {
-                continue;
-            }
+            continue;
+        }
 
-            assert(width == texture.width() && height == texture.height() && comp == 3);
-            m.texture = std::vector<uint8_t>(pixels, pixels + width * height * comp);
-            stbi_image_free(pixels);
-            m.format = texture_format::rgb;
+        auto& source = m.data.source_texture;
+        source.data = texture.data;
+        source.width = static_cast<int>(texture.width);
+        source.height = static_cast<int>(texture.height);
+
+        // Decoded right before the upload, see texture_decoder
+        if (texture.format == Texture_Format_JPG)
+        {
+            source.encoding = texture_encoding::jpeg;
+            source.scale_shift = get_texture_scale_shift(*this, texture.width, texture.height);
         }
-        else if (texture.format() == Texture_Format_CRN_DXT1)
+        else if (texture.format == Texture_Format_CRN_DXT1)
         {
-            auto src_size = tex.size();
-            auto src = reinterpret_cast<uint8_t*>(tex.data());
-            auto dst_size = crn_get_decompressed_size(src, static_cast<uint32_t>(src_size), 0);
-            assert(dst_size == ((texture.width() + 3) / 4) * ((texture.height() + 3) / 4) * 8);
-            m.texture = std::vector<uint8_t>(dst_size);
-            crn_decompress(src, static_cast<uint32_t>(src_size), m.texture.data(), dst_size, 0);
-            m.format = texture_format::dxt1;
+            source.encoding = texture_encoding::crn_dxt1;
         }
         else
         {
-            throw std::runtime_error("Unsupported texture format: " + std::to_string(texture.format()));
+            throw std::runtime_error("Unsupported texture format: " + std::to_string(texture.format));
         }
 
-        m.texture_width = static_cast<int>(texture.width());
-        m.texture_height = static_cast<int>(texture.height());
+        const auto stats = convert_to_triangle_list(m);
+        const auto total_triangles = static_cast<float>(this->cache_stats_.triangles + stats.triangles);
+        if (total_triangles > 0.0f)
+        {
+            const auto old_weight = static_cast<float>(this->cache_stats_.triangles) / total_triangles;
+            const auto new_weight = static_cast<float>(stats.triangles) / total_triangles;
+
+            this->cache_stats_.strip_acmr = this->cache_stats_.strip_acmr * old_weight + stats.strip_acmr * new_weight;
+            this->cache_stats_.list_acmr = this->cache_stats_.list_acmr * old_weight + stats.list_acmr * new_weight;
+            this->cache_stats_.triangles += stats.triangles;
+        }
 
         this->vertices_ += m.vertices.size();
-        this->meshes_.emplace_back(std::move(m));
+        meshes.emplace_back(std::move(m));
+    }
+
+    pack_meshes(*this, meshes);
+
+    this->get_rocktree().record_vertex_cache_stats(this->cache_stats_);
+
+    this->write_decoded_cache_file(serialize_decoded_node(*this));
+}
+
+bool node::populate_from_decoded_cache(const std::span<const uint8_t> data)
+{
+    try
+    {
+        if (deserialize_decoded_node(*this, data))
+        {
+            this->get_rocktree().record_vertex_cache_stats(this->cache_stats_);
+            return true;
+        }
+    }
+    catch (const std::exception& e)
+    {
+#ifdef NDEBUG
+        (void)e;
+#else
+        puts(e.what());
+#endif
+    }
+
+    node::clear();
+    return false;
+}
+
+void node::store_decoded_textures()
+{
+    if (this->has_stored_textures_ || std::ranges::none_of(this->meshes_, has_transcoded_texture))
+    {
+        return;
     }
 
-    this->meshes_.shrink_to_fit();
+    this->has_stored_textures_ = true;
+    this->write_decoded_cache_file(serialize_decoded_node(*this));
 }
 
 void node::clear()
 {
+    this->has_stored_textures_ = false;
     this->meshes_ = {};
+    this->payload_ = {};
+    this->payload_size_ = 0;
     this->vertices_ = 0;
+    this->cache_stats_ = {};
 }
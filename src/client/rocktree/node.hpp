@@ -3,7 +3,7 @@
 #include "octant_identifier.hpp"
 #include "rocktree_object.hpp"
 
-#include "../mesh.hpp"
+#include "../mesh_data.hpp"
 
 class bulk;
 
@@ -14,6 +14,13 @@ struct oriented_bounding_box
     glm::dmat3 orientation{};
 };
 
+struct vertex_cache_stats
+{
+    float strip_acmr{};
+    float list_acmr{};
+    size_t triangles{};
+};
+
 class node_data;
 
 template <typename NodeData>
@@ -43,13 +50,25 @@ class node : public rocktree_object
     static_node_data sdata_{};
 
     uint64_t vertices_{};
+    vertex_cache_stats cache_stats_{};
     std::vector<mesh_data> meshes_{};
+    std::unique_ptr<uint8_t[]> payload_{}; // vertices, indices and source textures of all meshes
+    size_t payload_size_{};
+    bool has_stored_textures_{}; // the decoded cache entry has the transcoded textures
+
+    // Rewrites the decoded cache entry with the transcoded textures, call once they are decoded. Later calls do nothing.
+    void store_decoded_textures();
 
     uint64_t get_vertices() const
     {
         return this->vertices_;
     }
 
+    const vertex_cache_stats& get_vertex_cache_stats() const
+    {
+        return this->cache_stats_;
+    }
+
     template <typename NodeData>
     typed_node<NodeData>& as()
     {
@@ -80,7 +99,13 @@ class node : public rocktree_object
     std::filesystem::path get_filepath() const override;
 
   protected:
-    void populate(const std::optional<std::string>& data) override;
+    void populate(std::span<const uint8_t> data) override;
+    bool has_decoded_cache() const override
+    {
+        return true;
+    }
+
+    bool populate_from_decoded_cache(std::span<const uint8_t> data) override;
     void clear() override;
 };
 
@@ -149,12 +174,23 @@ class typed_node : public node
   private:
     std::unique_ptr<NodeData> data_{};
 
-    void populate(const std::optional<std::string>& data) override
+    void populate(std::span<const uint8_t> data) override
     {
         node::populate(data);
         this->data_ = std::make_unique<NodeData>(*this);
     }
 
+    bool populate_from_decoded_cache(std::span<const uint8_t> data) override
+    {
+        if (!node::populate_from_decoded_cache(data))
+        {
+            return false;
+        }
+
+        this->data_ = std::make_unique<NodeData>(*this);
+        return true;
+    }
+
     void clear() override
     {
         this->data_ = {};
@@ -0,0 +1,142 @@
+#pragma once
+
+// Returns an object to the pool it came from, lets one list own objects of different pools
+template <typename Base>
+struct pool_deleter
+{
+    void (*release)(void* pool, Base* object){};
+    void* pool{};
+
+    void operator()(Base* object) const
+    {
+        if (object)
+        {
+            this->release(this->pool, object);
+        }
+    }
+};
+
+template <typename Base>
+using pooled_ptr = std::unique_ptr<Base, pool_deleter<Base>>;
+
+struct object_pool_stats
+{
+    size_t used{};
+    size_t capacity{};
+    size_t slabs{};
+    uint64_t allocations{}; // objects created over the lifetime of the pool
+};
+
+// Slab allocator for objects of one layout. Slots are carved out of slabs of SlabSize and recycled through an intrusive
+// free list, so creating an object is a pointer pop instead of a heap allocation. Slabs are kept until the pool goes away,
+// the tree tends to grow back to its previous size.
+template <typename T, size_t SlabSize = 256>
+class object_pool
+{
+  public:
+    object_pool() = default;
+
+    ~object_pool()
+    {
+        assert(this->used_ == 0);
+    }
+
+    object_pool(object_pool&&) = delete;
+    object_pool(const object_pool&) = delete;
+    object_pool& operator=(object_pool&&) = delete;
+    object_pool& operator=(const object_pool&) = delete;
+
+    // Anything with the layout of T fits, like a derived type that adds nothing but trivial members
+    template <typename U = T, typename Base = U, typename... Args>
+    pooled_ptr<Base> create(Args&&... args)
+    {
+        static_assert(std::is_base_of_v<Base, U>);
+        static_assert(sizeof(U) <= sizeof(slot) && alignof(U) <= alignof(slot));
+
+        auto* memory = this->allocate();
+
+        U* object{};
+
+        try
+        {
+            object = new (memory) U(std::forward<Args>(args)...);
+        }
+        catch (...)
+        {
+            this->deallocate(memory);
+            throw;
+        }
+
+        return pooled_ptr<Base>{object, pool_deleter<Base>{&object_pool::release<U, Base>, this}};
+    }
+
+    object_pool_stats get_stats() const
+    {
+        std::lock_guard _{this->mutex_};
+
+        return {
+            .used = this->used_,
+            .capacity = this->slabs_.size() * SlabSize,
+            .slabs = this->slabs_.size(),
+            .allocations = this->allocations_,
+        };
+    }
+
+  private:
+    union slot
+    {
+        slot* next;
+        alignas(T) std::byte storage[sizeof(T)];
+    };
+
+    mutable std::mutex mutex_{};
+    std::vector<std::unique_ptr<slot[]>> slabs_{};
+    slot* free_list_{};
+    size_t used_{};
+    uint64_t allocations_{};
+
+    void* allocate()
+    {
+        std::lock_guard _{this->mutex_};
+
+        if (!this->free_list_)
+        {
+            auto& slab = this->slabs_.emplace_back(std::make_unique_for_overwrite<slot[]>(SlabSize));
+
+            for (size_t i = SlabSize; i > 0; --i)
+            {
+                slab[i - 1].next = this->free_list_;
+                this->free_list_ = &slab[i - 1];
+            }
+        }
+
+        auto* s = this->free_list_;
+        this->free_list_ = s->next;
+
+        ++this->used_;
+        ++this->allocations_;
+
+        return s->storage;
+    }
+
+    void deallocate(void* memory)
+    {
+        auto* s = static_cast<slot*>(memory);
+
+        std::lock_guard _{this->mutex_};
+
+        s->next = this->free_list_;
+        this->free_list_ = s;
+
+        --this->used_;
+    }
+
+    template <typename U, typename Base>
+    static void release(void* pool, Base* object)
+    {
+        auto* typed_object = static_cast<U*>(object);
+        typed_object->~U();
+
+        static_cast<object_pool*>(pool)->deallocate(typed_object);
+    }
+};
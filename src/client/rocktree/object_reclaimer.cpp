@@ -0,0 +1,278 @@
+#include <std_include.hpp>
+
+#include "object_reclaimer.hpp"
+#include "rocktree_object.hpp"
+
+#include <utils/timer.hpp>
+
+namespace
+{
+    // Heap order, the front expires first
+    template <typename Entry>
+    bool expires_after(const Entry& a, const Entry& b)
+    {
+        return a.time > b.time;
+    }
+
+    std::chrono::steady_clock::time_point get_expiry(const generic_object& object)
+    {
+        return object.get_expiry(object_reclaimer::unused_timeout, object_reclaimer::fetching_timeout, object_reclaimer::failed_timeout);
+    }
+}
+
+void object_reclaimer::add(pooled_ptr<rocktree_object> object)
+{
+    std::lock_guard _{this->mutex_};
+
+    uint32_t index{};
+
+    if (this->free_slots_.empty())
+    {
+        index = static_cast<uint32_t>(this->slots_.size());
+        this->slots_.emplace_back();
+    }
+    else
+    {
+        index = this->free_slots_.back();
+        this->free_slots_.pop_back();
+    }
+
+    auto& entry = this->slots_[index];
+    object->handle_ = {index, entry.generation};
+    entry.object = std::move(object);
+
+    ++this->objects_;
+}
+
+void object_reclaimer::notify(const object_handle handle)
+{
+    if (!handle.is_valid())
+    {
+        return;
+    }
+
+    std::lock_guard _{this->mutex_};
+
+    auto& entry = this->slots_[handle.index];
+    if (entry.generation != handle.generation || entry.is_queued || entry.is_retired)
+    {
+        return;
+    }
+
+    entry.is_queued = true;
+    this->changed_.push_back(handle);
+}
+
+void object_reclaimer::advance_epoch()
+{
+    ++this->epoch_;
+}
+
+void object_reclaimer::reclaim(const std::chrono::milliseconds& timeout)
+{
+    const utils::timer timer{};
+
+    {
+        std::lock_guard _{this->mutex_};
+
+        for (const auto& handle : this->changed_)
+        {
+            auto& entry = this->slots_[handle.index];
+            if (entry.generation == handle.generation)
+            {
+                entry.is_queued = false;
+            }
+        }
+
+        this->backlog_.insert(this->backlog_.end(), this->changed_.begin(), this->changed_.end());
+        this->changed_.clear();
+
+        this->is_scheduled_.resize(this->slots_.size(), false);
+    }
+
+    // Deletions that were blocked last time, like a mesh that was still buffering
+    this->backlog_.insert(this->backlog_.end(), this->retries_.begin(), this->retries_.end());
+    this->retries_.clear();
+
+    while (!this->backlog_.empty() && !timer.has_elapsed(timeout))
+    {
+        const auto handle = this->backlog_.back();
+        this->backlog_.pop_back();
+
+        if (auto* object = this->resolve(handle))
+        {
+            this->process(handle, *object);
+        }
+    }
+
+    const auto now = std::chrono::steady_clock::now();
+
+    while (!this->expiries_.empty() && this->expiries_.front().time <= now && !timer.has_elapsed(timeout))
+    {
+        std::ranges::pop_heap(this->expiries_, expires_after<expiry>);
+        const auto handle = this->expiries_.back().handle;
+        this->expiries_.pop_back();
+
+        // Entries of freed objects stay in the heap until they are due, the new owner of the slot keeps its flag
+        auto* object = this->resolve(handle);
+        if (!object)
+        {
+            continue;
+        }
+
+        this->is_scheduled_[handle.index] = false;
+        this->expire(handle, *object);
+    }
+
+    this->free_retired();
+}
+
+size_t object_reclaimer::get_objects() const
+{
+    std::lock_guard _{this->mutex_};
+    return this->objects_;
+}
+
+// Retired objects are only freed by the reclaiming thread, so the pointer stays valid without holding the lock
+rocktree_object* object_reclaimer::resolve(const object_handle handle)
+{
+    std::lock_guard _{this->mutex_};
+
+    const auto& entry = this->slots_[handle.index];
+    if (entry.generation != handle.generation || entry.is_retired)
+    {
+        return nullptr;
+    }
+
+    return entry.object.get();
+}
+
+void object_reclaimer::process(const object_handle handle, rocktree_object& object)
+{
+    if (!object.has_parent())
+    {
+        // A stopped fetch reports back once it gave up
+        if (!object.mark_for_deletion())
+        {
+            return;
+        }
+
+        if (!object.try_perform_deletion())
+        {
+            this->retries_.push_back(handle);
+            return;
+        }
+
+        // Keeps a frame that still sees the object from fetching it again
+        object.mark_for_deletion();
+        this->retire(handle);
+        return;
+    }
+
+    if (object.is_being_deleted())
+    {
+        if (!object.try_perform_deletion())
+        {
+            this->retries_.push_back(handle);
+        }
+
+        return;
+    }
+
+    if (object.is_fetching() || object.is_in_final_state())
+    {
+        this->schedule_expiry(handle, object);
+    }
+}
+
+void object_reclaimer::schedule_expiry(const object_handle handle, const rocktree_object& object)
+{
+    if (this->is_scheduled_[handle.index])
+    {
+        return;
+    }
+
+    this->is_scheduled_[handle.index] = true;
+
+    this->expiries_.push_back({get_expiry(object), handle});
+    std::ranges::push_heap(this->expiries_, expires_after<expiry>);
+}
+
+void object_reclaimer::expire(const object_handle handle, rocktree_object& object)
+{
+    if (object.has_parent() && !object.is_being_deleted())
+    {
+        // Deleted meanwhile, it is scheduled again once it is fetched
+        if (!object.is_fetching() && !object.is_in_final_state())
+        {
+            return;
+        }
+
+        // Used since it was scheduled, look again when the new timeout runs out
+        if (std::chrono::steady_clock::now() < get_expiry(object))
+        {
+            this->schedule_expiry(handle, object);
+            return;
+        }
+
+        if (!object.mark_for_deletion())
+        {
+            return;
+        }
+    }
+
+    this->process(handle, object);
+}
+
+void object_reclaimer::retire(const object_handle handle)
+{
+    {
+        std::lock_guard _{this->mutex_};
+        this->slots_[handle.index].is_retired = true;
+    }
+
+    this->retired_.push_back({this->epoch_.load(), handle});
+}
+
+void object_reclaimer::free_retired()
+{
+    const auto epoch = this->epoch_.load();
+
+    while (!this->retired_.empty() && this->retired_.front().epoch < epoch)
+    {
+        const auto handle = this->retired_.front().handle;
+        this->retired_.pop_front();
+
+        rocktree_object* object{};
+
+        {
+            std::lock_guard _{this->mutex_};
+            object = this->slots_[handle.index].object.get();
+        }
+
+        // A frame picked it up before it was retired, wait until the fetch it started gave up
+        if (!object->mark_for_deletion() || !object->try_perform_deletion())
+        {
+            this->retired_.push_back({epoch, handle});
+            continue;
+        }
+
+        // Destroyed outside of the lock
+        pooled_ptr<rocktree_object> owner{};
+
+        {
+            std::lock_guard _{this->mutex_};
+
+            auto& entry = this->slots_[handle.index];
+            owner = std::move(entry.object);
+            ++entry.generation;
+            entry.is_queued = false;
+            entry.is_retired = false;
+
+            this->free_slots_.push_back(handle.index);
+            --this->objects_;
+        }
+
+        this->is_scheduled_[handle.index] = false;
+    }
+}
@@ -0,0 +1,101 @@
+#pragma once
+
+#include "object_pool.hpp"
+
+class rocktree_object;
+
+// Names a registered object without keeping it alive. The generation changes whenever the slot is reused,
+// so a handle that outlived its object resolves to nothing instead of to whatever took the slot.
+struct object_handle
+{
+    static constexpr uint32_t invalid_index = std::numeric_limits<uint32_t>::max();
+
+    uint32_t index{invalid_index};
+    uint32_t generation{};
+
+    bool is_valid() const
+    {
+        return this->index != invalid_index;
+    }
+};
+
+// Owns every bulk and node of a rocktree and frees them again. Nothing walks the tree for that, objects report their
+// state changes (started fetching, finished, marked for deletion, unlinked from their parent) and only those get looked at.
+// Objects in use are checked again when their timeout runs out, so the cost follows the churn, not the size of the tree.
+//
+// Unlinked objects are retired first and freed once the readers advanced the epoch, a frame that still holds
+// a pointer it found before the unlink is done with it by then.
+class object_reclaimer
+{
+  public:
+    // An object unused for longer than this is deleted, depending on the state it is in
+    static constexpr std::chrono::milliseconds unused_timeout{10'000};
+    static constexpr std::chrono::milliseconds fetching_timeout{5'000};
+    static constexpr std::chrono::milliseconds failed_timeout{3'000};
+
+    object_reclaimer() = default;
+    ~object_reclaimer() = default;
+
+    object_reclaimer(object_reclaimer&&) = delete;
+    object_reclaimer(const object_reclaimer&) = delete;
+    object_reclaimer& operator=(object_reclaimer&&) = delete;
+    object_reclaimer& operator=(const object_reclaimer&) = delete;
+
+    // Safe from any thread, the object must not be reachable by others before this returns
+    void add(pooled_ptr<rocktree_object> object);
+
+    // Safe from any thread, the object is looked at during the next reclaim(). Repeated notifications are merged.
+    void notify(object_handle handle);
+
+    // Called by the readers of the tree once they dropped every object pointer they had
+    void advance_epoch();
+
+    // Deletes, retires and frees what changed since the last call. Only one thread may reclaim.
+    void reclaim(const std::chrono::milliseconds& timeout);
+
+    size_t get_objects() const;
+
+  private:
+    struct slot
+    {
+        pooled_ptr<rocktree_object> object{};
+        uint32_t generation{};
+        bool is_queued{false};
+        bool is_retired{false};
+    };
+
+    struct expiry
+    {
+        std::chrono::steady_clock::time_point time{};
+        object_handle handle{};
+    };
+
+    struct retired_object
+    {
+        uint64_t epoch{};
+        object_handle handle{};
+    };
+
+    mutable std::mutex mutex_{};
+    std::vector<slot> slots_{};
+    std::vector<uint32_t> free_slots_{};
+    std::vector<object_handle> changed_{};
+    size_t objects_{};
+
+    std::atomic<uint64_t> epoch_{0};
+
+    // Only touched by the reclaiming thread
+    std::vector<object_handle> backlog_{};
+    std::vector<object_handle> retries_{};
+    std::vector<expiry> expiries_{};
+    std::vector<bool> is_scheduled_{};
+    std::deque<retired_object> retired_{};
+
+    rocktree_object* resolve(object_handle handle);
+
+    void process(object_handle handle, rocktree_object& object);
+    void schedule_expiry(object_handle handle, const rocktree_object& object);
+    void expire(object_handle handle, rocktree_object& object);
+    void retire(object_handle handle);
+    void free_retired();
+};
@@ -1,7 +1,8 @@
-#include "../std_include.hpp"
+#include <std_include.hpp>
 
 #include "planetoid.hpp"
 #include "bulk.hpp"
+#include "rocktree.hpp"
 
 #include "rocktree_proto.hpp"
 
@@ -15,19 +16,18 @@ std::filesystem::path planetoid::get_filepath() const
     return this->get_url();
 }
 
-void planetoid::populate(const std::optional<std::string>& data)
+void planetoid::populate(const std::span<const uint8_t> data)
 {
     PlanetoidMetadata planetoid{};
-    if (!data || !planetoid.ParseFromString(*data))
+    if (!planetoid.ParseFromArray(data.data(), static_cast<int>(data.size())))
     {
-        throw std::runtime_error{"Failed to fetch planetoid"};
+        throw std::runtime_error{"Failed to parse planetoid"};
     }
 
     this->radius = planetoid.radius();
-    this->root_bulk = this->allocate_object<bulk>(this->get_rocktree(), *this,
-                                                  static_bulk_data{
-                                                      planetoid.root_node_metadata().epoch(),
-                                                  });
+    this->root_bulk = this->get_rocktree().allocate_bulk(*this, static_bulk_data{
+                                                                    planetoid.root_node_metadata().epoch(),
+                                                                });
 }
 
 void planetoid::clear()
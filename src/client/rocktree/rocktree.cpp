@@ -1,4 +1,4 @@
-#include "../std_include.hpp"
+#include <std_include.hpp>
 
 #include "rocktree.hpp"
 #include "planetoid.hpp"
@@ -6,72 +6,33 @@
 #include "rocktree_proto.hpp"
 
 #include <utils/http.hpp>
-#include <utils/timer.hpp>
 #include <utils/finally.hpp>
 
-rocktree::rocktree(std::string planet)
-    : planet_(std::move(planet))
+rocktree::rocktree(std::string planet, std::string base_url)
+    : planet_(std::move(planet)),
+      base_url_(std::move(base_url)),
+      store_(std::filesystem::temp_directory_path() / "bird" / this->planet_ / "store"),
+      io_engine_(this->store_, this->task_manager_)
 {
     this->planetoid_ = std::make_unique<planetoid>(*this);
 }
 
 rocktree::~rocktree()
 {
+    // Reads complete through the task manager, it has to run until the io engine answered all of them
     this->downloader_.stop();
+    this->io_engine_.stop();
     this->task_manager_.stop();
 }
 
-void rocktree::cleanup_dangling_objects(const std::chrono::milliseconds& timeout)
+void rocktree::reclaim_objects(const std::chrono::milliseconds& timeout)
 {
-    object_list new_objects{};
-    this->new_objects_.access([&new_objects](object_list& objects) {
-        if (!objects.empty())
-        {
-            new_objects = std::move(objects);
-            objects = object_list();
-        }
-    });
-
-    this->objects_.access([&](object_list& objects) {
-        const utils::timer timer{};
-
-        if (this->object_iterator_ == objects.end())
-        {
-            this->object_iterator_ = objects.begin();
-        }
-
-        if (!new_objects.empty())
-        {
-            objects.splice(objects.end(), new_objects);
-        }
-
-        while (this->object_iterator_ != objects.end())
-        {
-            if (timer.has_elapsed(timeout))
-            {
-                return;
-            }
-
-            auto& object = **this->object_iterator_;
-
-            const auto is_unused = !object.has_parent();
-            const auto is_final = object.is_in_final_state();
-
-            if (is_unused && is_final)
-            {
-                this->object_iterator_ = objects.erase(this->object_iterator_);
-            }
-            else
-            {
-                if (is_unused)
-                {
-                    object.mark_for_deletion();
-                }
+    this->reclaimer_.reclaim(timeout);
+}
 
-                ++this->object_iterator_;
-            }
-        }
-    });
+void rocktree::advance_epoch()
+{
+    this->reclaimer_.advance_epoch();
 }
 
 size_t rocktree::get_tasks() const
@@ -89,12 +50,66 @@ size_t rocktree::get_downloads() const
     return this->downloader_.get_downloads();
 }
 
+utils::http::concurrency_controller::state rocktree::get_download_state() const
+{
+    return this->downloader_.get_concurrency_state();
+}
+
+size_t rocktree::get_io_operations() const
+{
+    return this->io_engine_.get_in_flight();
+}
+
+std::chrono::microseconds rocktree::get_io_latency() const
+{
+    return this->io_engine_.get_average_latency();
+}
+
+negative_cache::stats rocktree::get_fetch_failures() const
+{
+    return this->negative_cache_.get_stats();
+}
+
+void rocktree::record_vertex_cache_stats(const vertex_cache_stats& stats)
+{
+    const auto triangles = static_cast<double>(stats.triangles);
+
+    this->strip_cache_misses_ += static_cast<uint64_t>(std::llround(static_cast<double>(stats.strip_acmr) * triangles));
+    this->list_cache_misses_ += static_cast<uint64_t>(std::llround(static_cast<double>(stats.list_acmr) * triangles));
+    this->cache_triangles_ += stats.triangles;
+}
+
+vertex_cache_stats rocktree::get_vertex_cache_stats() const
+{
+    vertex_cache_stats stats{};
+    stats.triangles = this->cache_triangles_;
+
+    if (stats.triangles > 0)
+    {
+        const auto triangles = static_cast<double>(stats.triangles);
+        stats.strip_acmr = static_cast<float>(static_cast<double>(this->strip_cache_misses_.load()) / triangles);
+        stats.list_acmr = static_cast<float>(static_cast<double>(this->list_cache_misses_.load()) / triangles);
+    }
+
+    return stats;
+}
+
 size_t rocktree::get_objects() const
 {
-    return this->objects_.get_raw().size();
+    return this->reclaimer_.get_objects();
+}
+
+object_pool_stats rocktree::get_bulk_pool_stats() const
+{
+    return this->bulk_pool_.get_stats();
+}
+
+object_pool_stats rocktree::get_node_pool_stats() const
+{
+    return this->node_pool_.get_stats();
 }
 
-void rocktree::store_object(std::unique_ptr<generic_object> object)
+void rocktree::store_object(pooled_ptr<rocktree_object> object)
 {
-    this->new_objects_.access([&](object_list& list) { list.push_back(std::move(object)); });
+    this->reclaimer_.add(std::move(object));
 }
@@ -5,7 +5,13 @@
 #include "node.hpp"
 #include "bulk.hpp"
 #include "planetoid.hpp"
+#include "tile_store.hpp"
+#include "io_engine.hpp"
+#include "negative_cache.hpp"
+#include "object_pool.hpp"
+#include "object_reclaimer.hpp"
 
+#include "../pipeline.hpp"
 #include "../task_manager.hpp"
 
 #include <utils/http.hpp>
@@ -20,7 +26,9 @@ class rocktree
   public:
     friend rocktree_object;
 
-    rocktree(std::string planet);
+    static constexpr char default_base_url[] = "http://kh.google.com/rt/";
+
+    rocktree(std::string planet, std::string base_url = default_base_url);
     virtual ~rocktree();
 
     const std::string& get_planet() const
@@ -28,6 +36,11 @@ class rocktree
         return this->planet_;
     }
 
+    const std::string& get_base_url() const
+    {
+        return this->base_url_;
+    }
+
     planetoid* get_planetoid() const
     {
         return this->planetoid_.get();
@@ -38,22 +51,51 @@ class rocktree
         return this->task_manager_;
     }
 
+    pipeline::stats& get_pipeline_stats()
+    {
+        return this->pipeline_stats_;
+    }
+
+    const pipeline::stats& get_pipeline_stats() const
+    {
+        return this->pipeline_stats_;
+    }
+
     virtual node* allocate_node(bulk& parent, static_node_data&& data)
     {
-        auto obj = std::make_unique<node>(*this, parent, std::move(data));
-        auto* ptr = obj.get();
+        return this->create_node<node>(parent, std::move(data));
+    }
+
+    bulk* allocate_bulk(const generic_object& parent, static_bulk_data&& data)
+    {
+        auto obj = this->bulk_pool_.create<bulk, rocktree_object>(*this, parent, std::move(data));
+        auto* ptr = static_cast<bulk*>(obj.get());
 
         this->store_object(std::move(obj));
 
         return ptr;
     }
 
-    void cleanup_dangling_objects(const std::chrono::milliseconds& timeout);
+    // Deletes unused objects and frees unlinked ones, see object_reclaimer
+    void reclaim_objects(const std::chrono::milliseconds& timeout);
+
+    // Called by whoever walks the tree, once per walk and after it let go of every object it found
+    void advance_epoch();
 
     size_t get_tasks() const;
     size_t get_tasks(size_t i) const;
     size_t get_downloads() const;
+    utils::http::concurrency_controller::state get_download_state() const;
+    size_t get_io_operations() const;
+    std::chrono::microseconds get_io_latency() const;
+    negative_cache::stats get_fetch_failures() const;
+
+    // Totals over every node decoded so far, the ratios are weighted by triangles
+    void record_vertex_cache_stats(const vertex_cache_stats& stats);
+    vertex_cache_stats get_vertex_cache_stats() const;
     size_t get_objects() const;
+    object_pool_stats get_bulk_pool_stats() const;
+    object_pool_stats get_node_pool_stats() const;
 
     template <typename RocktreeData>
     typed_rocktree<RocktreeData>& as()
@@ -81,26 +123,47 @@ class rocktree
 
   private:
     std::string planet_{};
+    std::string base_url_{};
 
-    using object_list = std::list<std::unique_ptr<generic_object>>;
-    utils::concurrency::container<object_list> objects_{};
-    utils::concurrency::container<object_list> new_objects_{};
-    object_list::iterator object_iterator_ = objects_.get_raw().end();
+    // Every typed_node only adds its data pointer to node, so one pool layout fits all of them
+    object_pool<bulk, 64> bulk_pool_{};
+    object_pool<typed_node<node_data>> node_pool_{};
+
+    object_reclaimer reclaimer_{};
 
     std::unique_ptr<planetoid> planetoid_{};
+    tile_store store_;
     utils::http::downloader downloader_{};
     task_manager task_manager_{};
+    io_engine io_engine_;
+    negative_cache negative_cache_{};
+    pipeline::stats pipeline_stats_{};
+
+    std::atomic_uint64_t strip_cache_misses_{0};
+    std::atomic_uint64_t list_cache_misses_{0};
+    std::atomic_uint64_t cache_triangles_{0};
 
   protected:
-    void store_object(std::unique_ptr<generic_object> object);
+    void store_object(pooled_ptr<rocktree_object> object);
+
+    template <typename Node>
+    node* create_node(bulk& parent, static_node_data&& data)
+    {
+        auto obj = this->node_pool_.create<Node, rocktree_object>(*this, parent, std::move(data));
+        auto* ptr = static_cast<node*>(static_cast<Node*>(obj.get()));
+
+        this->store_object(std::move(obj));
+
+        return ptr;
+    }
 };
 
 template <typename RocktreeData>
 class typed_rocktree : public rocktree
 {
   public:
-    typed_rocktree(std::string planet, RocktreeData& data)
-        : rocktree(std::move(planet)),
+    typed_rocktree(std::string planet, RocktreeData& data, std::string base_url = default_base_url)
+        : rocktree(std::move(planet), std::move(base_url)),
           data_(&data)
     {
     }
@@ -127,11 +190,6 @@ class custom_rocktree : public typed_rocktree<RocktreeData>
 
     node* allocate_node(bulk& parent, static_node_data&& data) override
     {
-        auto obj = std::make_unique<typed_node<NodeData>>(*this, parent, std::move(data));
-        auto* ptr = obj.get();
-
-        this->store_object(std::move(obj));
-
-        return ptr;
+        return this->template create_node<typed_node<NodeData>>(parent, std::move(data));
     }
 };
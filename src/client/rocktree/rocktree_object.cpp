@@ -2,122 +2,102 @@
 
 #include "rocktree.hpp"
 
-#include <utils/io.hpp>
-
 namespace
 {
-    XXH32_hash_t calculate_hash(const void* data, const size_t size)
+    std::string build_google_url(const std::string_view& base_url, const std::string_view& planet, const std::string_view& path)
     {
-        return XXH32(data, size, 0x12345678);
-    }
+        std::string url{};
+        url.reserve(base_url.size() + planet.size() + path.size() + 1);
 
-    XXH32_hash_t calculate_hash(const std::string_view& data)
-    {
-        return calculate_hash(data.data(), data.size());
+        url.append(base_url);
+        url.append(planet);
+        url.push_back('/');
+        url.append(path);
+
+        return url;
     }
 
-    bool write_cache_file(const std::filesystem::path& file, std::string data)
+    std::string build_cache_key(const std::filesystem::path& path)
     {
-        const auto hash = calculate_hash(data);
-        data.append(reinterpret_cast<const char*>(&hash), sizeof(hash));
-
-        return utils::io::write_file(file, data);
+        return path.generic_string();
     }
 
-    std::optional<std::string> read_cache_file(const std::filesystem::path& file)
+    // Continues on a task manager worker with the cached bytes, see io_engine::read
+    class read_cache
     {
-        std::string data{};
-        if (!utils::io::read_file(file, &data))
+      public:
+        read_cache(io_engine& io, std::string key)
+            : io_(&io),
+              key_(std::move(key))
         {
-            return {};
         }
 
-        XXH32_hash_t stored_hash{};
-        constexpr auto hash_size = sizeof(stored_hash);
-        if (data.size() < hash_size)
+        bool await_ready() const noexcept
         {
-            return {};
+            return false;
         }
 
-        memcpy(&stored_hash, data.data() + data.size() - hash_size, hash_size);
-
-        const auto* start = data.data();
-        const auto size = data.size() - hash_size;
-
-        const auto calculated_hash = calculate_hash(start, size);
-        if (stored_hash != calculated_hash)
+        void await_suspend(const std::coroutine_handle<> handle)
         {
-            return {};
+            this->io_->read(std::move(this->key_), [this, handle](std::optional<utils::shared_buffer> data) {
+                this->data_ = std::move(data);
+                handle.resume();
+            });
         }
 
-        data.resize(size);
-        return data;
-    }
-
-    std::string build_google_url(const std::string_view& planet, const std::string_view& path)
-    {
-        static constexpr char base_url[] = "http://kh.google.com/rt/";
-
-        std::string url{};
-        // base_url nullterminator and slash cancel out
-        url.reserve(sizeof(base_url) + planet.size() + path.size());
-
-        url.append(base_url);
-        url.append(planet);
-        url.push_back('/');
-        url.append(path);
+        std::optional<utils::shared_buffer> await_resume() noexcept
+        {
+            return std::move(this->data_);
+        }
 
-        return url;
-    }
+      private:
+        io_engine* io_{};
+        std::string key_{};
+        std::optional<utils::shared_buffer> data_{};
+    };
 
-    std::filesystem::path build_cache_url(const std::string_view& planet, const std::filesystem::path& path)
+    // Continues on the download thread, without data if the token was stopped meanwhile
+    class download
     {
-        return std::filesystem::temp_directory_path() / "bird" / (planet / path);
-    }
+      public:
+        download(utils::http::downloader& downloader, std::string url, utils::thread::stop_token token,
+                 const utils::http::request_priority priority)
+            : downloader_(&downloader),
+              url_(std::move(url)),
+              token_(std::move(token)),
+              priority_(priority)
+        {
+        }
 
-    void fetch_google_data(task_manager& manager, utils::http::downloader& downloader, const std::string_view& planet,
-                           const std::string_view& path, const std::filesystem::path& file_path, utils::http::result_function callback,
-                           utils::thread::stop_token token, const bool prefer_cache, const bool high_priority)
-    {
-        if (token.stop_requested())
+        bool await_ready() const noexcept
         {
-            callback({});
-            return;
+            return false;
         }
 
-        auto cache_url = build_cache_url(planet, file_path);
-        if (prefer_cache)
+        void await_suspend(const std::coroutine_handle<> handle)
         {
-            auto data = read_cache_file(cache_url);
-            if (data)
-            {
-                callback(std::move(data));
-                return;
-            }
+            // The downloader answers every request, stopped ones included
+            this->downloader_->download(
+                std::move(this->url_),
+                [this, handle](utils::http::response response) {
+                    this->response_ = std::move(response);
+                    handle.resume();
+                },
+                std::move(this->token_), this->priority_);
         }
 
-        auto dispatcher = [cache_url = std::move(cache_url), cb = std::move(callback), &manager](std::optional<std::string> result) {
-            if (result)
-            {
-                cb(result);
+        utils::http::response await_resume() noexcept
+        {
+            return std::move(this->response_);
+        }
 
-                manager.schedule([c = std::move(cache_url), r = std::move(std::move(result))] { write_cache_file(c, std::move(*r)); });
-            }
-            else
-            {
-                auto data = read_cache_file(cache_url);
-                cb(std::move(data));
-            }
-        };
-
-        const auto url = build_google_url(planet, path);
-        downloader.download(
-            url,
-            [&manager, d = std::move(dispatcher)](utils::http::result result) {
-                manager.schedule([r = std::move(result), dis = std::move(d)] { dis(std::move(r)); }, 0, false);
-            },
-            std::move(token), high_priority);
-    }
+      private:
+        utils::http::downloader* downloader_{};
+        std::string url_{};
+        utils::thread::stop_token token_{};
+        utils::http::request_priority priority_{};
+        utils::http::response response_{};
+    };
 }
 
 rocktree_object::rocktree_object(rocktree& rocktree, const generic_object* parent)
@@ -128,53 +108,195 @@ rocktree_object::rocktree_object(rocktree& rocktree, const generic_object* paren
 
 void rocktree_object::populate()
 {
-    this->get_rocktree().task_manager_.schedule(
-        [this] {
-            try
+    this->run_fetching();
+}
+
+void rocktree_object::on_state_changed()
+{
+    this->get_rocktree().reclaimer_.notify(this->handle_);
+}
+
+// Cache lookup, download and decoding of one object. Each co_await below is a hop to the executor of the next stage,
+// the stop token is checked after every hop so stale objects wrap up as soon as possible.
+pipeline::job rocktree_object::run_fetching()
+{
+    auto& rocktree = this->get_rocktree();
+    auto& stats = rocktree.pipeline_stats_;
+
+    const auto token = this->get_stop_token();
+    const auto is_high_priority = this->is_high_priority();
+    const auto* score = is_high_priority ? nullptr : &this->fetch_priority_;
+
+    const auto on_worker = [&](const size_t priority) {
+        return pipeline::resume_on(rocktree.task_manager_, {.priority = priority, .live_score = score, .token = token});
+    };
+
+    // The object may be freed once it is in a final state, reporting that only touches the rocktree
+    const auto finish = [this, &reclaimer = rocktree.reclaimer_, handle = this->handle_](const bool succeeded) {
+        this->finish_fetching(succeeded);
+        reclaimer.notify(handle);
+    };
+
+    auto success = false;
+
+    try
+    {
+        auto start = pipeline::clock::now();
+
+        const auto scheduled = co_await on_worker(1u + (is_high_priority ? 0u : 1u));
+
+        stats.record(pipeline::stage::queue, start);
+
+        const auto url = this->get_full_url();
+
+        // Neither the network nor the disk cache had it when it last failed, so there is nothing to look up before the backoff ends
+        if (!scheduled || rocktree.negative_cache_.is_blocked(url))
+        {
+            finish(false);
+            co_return;
+        }
+
+        if (this->prefer_cache() && this->has_decoded_cache())
+        {
+            start = pipeline::clock::now();
+            const auto decoded = co_await read_cache(rocktree.io_engine_, build_cache_key("Decoded" / this->get_filepath()));
+            stats.record(pipeline::stage::cache, start);
+
+            if (token.stop_requested())
             {
-                this->run_fetching();
+                finish(false);
+                co_return;
             }
-            catch (const std::exception& e)
+
+            start = pipeline::clock::now();
+
+            if (decoded && this->populate_from_decoded_cache(decoded->span()))
             {
-#ifdef NDEBUG
-                (void)e;
-#else
-                puts(e.what());
-#endif
-                this->finish_fetching(false);
+                stats.record(pipeline::stage::decode, start);
+                finish(true);
+                co_return;
             }
-        },
-        1 + (this->is_high_priority() ? 0 : 1), true);
-}
+        }
 
-void rocktree_object::run_fetching()
-{
-    const auto file_path = this->get_filepath();
-    const auto url_path = this->get_url();
-    auto& rocktree = this->get_rocktree();
+        const auto cache_key = build_cache_key(this->get_filepath());
+        std::optional<utils::shared_buffer> data{};
 
-    fetch_google_data( //
-        rocktree.task_manager_, rocktree.downloader_, rocktree.get_planet(), url_path, std::move(file_path),
-        [this](const utils::http::result& res) {
-            try
+        if (this->prefer_cache())
+        {
+            start = pipeline::clock::now();
+            data = co_await read_cache(rocktree.io_engine_, cache_key);
+            stats.record(pipeline::stage::cache, start);
+        }
+
+        if (!data && !token.stop_requested())
+        {
+            start = pipeline::clock::now();
+            auto response = co_await download(rocktree.downloader_, url, token, this->get_download_priority());
+            stats.record(pipeline::stage::download, start);
+
+            if (response.data)
             {
-                this->populate(res);
-                this->finish_fetching(true);
+                // The download is cached even if its object went stale meanwhile, only the decoding is dropped
+                rocktree.negative_cache_.record_success(url);
+                rocktree.io_engine_.write(cache_key, *response.data);
+
+                // Both share the downloaded block, neither copies it
+                data = std::move(response.data);
+
+                // Decoding leaves the download thread at the object's live priority
+                start = pipeline::clock::now();
+                const auto resumed = co_await on_worker(0);
+                stats.record(pipeline::stage::queue, start);
+
+                if (!resumed)
+                {
+                    finish(false);
+                    co_return;
+                }
             }
-            catch (const std::exception& e)
+            else if (!token.stop_requested())
             {
+                // Fall back to a stale copy, only remember the failure if there is none
+                start = pipeline::clock::now();
+                data = co_await read_cache(rocktree.io_engine_, cache_key);
+                stats.record(pipeline::stage::cache, start);
+
+                if (!data)
+                {
+                    rocktree.negative_cache_.record_failure(url, response.status);
+                }
+            }
+        }
+
+        if (token.stop_requested())
+        {
+            finish(false);
+            co_return;
+        }
+
+        if (!data)
+        {
+            throw std::runtime_error{"Failed to fetch " + this->get_url()};
+        }
+
+        start = pipeline::clock::now();
+        this->populate(data->span());
+        stats.record(pipeline::stage::decode, start);
+
+        success = true;
+    }
+    catch (const std::exception& e)
+    {
 #ifdef NDEBUG
-                (void)e;
+        (void)e;
 #else
-                puts(e.what());
+        puts(e.what());
 #endif
-                this->finish_fetching(false);
-            }
-        },
-        this->get_stop_token(), this->prefer_cache(), this->is_high_priority());
+    }
+
+    // Last touch of the object
+    finish(success);
+}
+
+void rocktree_object::set_fetch_priority(const utils::http::request_priority priority)
+{
+    this->fetch_priority_ = priority;
+
+    if (!this->is_fetching() || this->is_high_priority())
+    {
+        return;
+    }
+
+    // Small changes don't reorder much, skip them to keep the queue lock cold
+    const auto queued = this->queued_priority_.load();
+    if (std::abs(priority - queued) <= std::abs(queued) * 0.1)
+    {
+        return;
+    }
+
+    this->queued_priority_ = priority;
+    this->get_rocktree().downloader_.update_priority(this->get_full_url(), priority);
+}
+
+utils::http::request_priority rocktree_object::get_download_priority()
+{
+    if (this->is_high_priority())
+    {
+        return utils::http::highest_priority;
+    }
+
+    const auto priority = this->fetch_priority_.load();
+    this->queued_priority_ = priority;
+    return priority;
+}
+
+std::string rocktree_object::get_full_url() const
+{
+    const auto& rocktree = this->get_rocktree();
+    return build_google_url(rocktree.get_base_url(), rocktree.get_planet(), this->get_url());
 }
 
-void rocktree_object::store_object(std::unique_ptr<rocktree_object> object) const
+void rocktree_object::write_decoded_cache_file(std::string data) const
 {
-    this->get_rocktree().store_object(std::move(object));
+    this->get_rocktree().io_engine_.write(build_cache_key("Decoded" / this->get_filepath()), utils::shared_buffer{std::move(data)});
 }
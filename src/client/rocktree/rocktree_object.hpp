@@ -1,6 +1,11 @@
 #pragma once
 
 #include "generic_object.hpp"
+#include "object_reclaimer.hpp"
+
+#include "../pipeline.hpp"
+
+#include <utils/http.hpp>
 
 inline std::filesystem::path octant_path_to_directory(const std::string& path)
 {
@@ -22,6 +27,8 @@ class rocktree;
 class rocktree_object : public generic_object
 {
   public:
+    friend object_reclaimer;
+
     rocktree_object(rocktree& rocktree, const generic_object* parent);
 
     rocktree& get_rocktree() const
@@ -29,10 +36,21 @@ class rocktree_object : public generic_object
         return *this->rocktree_;
     }
 
+    // Orders queued downloads, set from the screen-space error during node selection.
+    // Re-prioritizes the pending download if the object is still being fetched.
+    void set_fetch_priority(utils::http::request_priority priority);
+
+    // Live score for tasks working on this object, see task_manager::task_options
+    const std::atomic<utils::http::request_priority>& get_fetch_priority() const
+    {
+        return this->fetch_priority_;
+    }
+
   protected:
     virtual std::string get_url() const = 0;
     virtual std::filesystem::path get_filepath() const = 0;
-    virtual void populate(const std::optional<std::string>& data) = 0;
+    // Only valid during the call, the bytes belong to the download or the mapped cache segment
+    virtual void populate(std::span<const uint8_t> data) = 0;
 
     virtual bool is_high_priority() const
     {
@@ -44,24 +62,29 @@ class rocktree_object : public generic_object
         return true;
     }
 
-    template <typename T, typename... Args>
-    T* allocate_object(Args&&... args)
+    // Second cache tier holding fully decoded objects, a hit skips both download and decoding
+    virtual bool has_decoded_cache() const
     {
-        static_assert(std::is_base_of_v<rocktree_object, T>);
-
-        auto obj = std::make_unique<T>(std::forward<Args>(args)...);
-        auto* ptr = obj.get();
-
-        this->store_object(std::move(obj));
+        return false;
+    }
 
-        return ptr;
+    virtual bool populate_from_decoded_cache(std::span<const uint8_t> data)
+    {
+        (void)data;
+        return false;
     }
 
+    void write_decoded_cache_file(std::string data) const;
+
   private:
     rocktree* rocktree_{};
+    object_handle handle_{}; // stays invalid for objects the rocktree does not reclaim, like the planetoid
+    std::atomic<utils::http::request_priority> fetch_priority_{0.0};
+    std::atomic<utils::http::request_priority> queued_priority_{0.0};
 
     void populate() override;
-    void run_fetching();
-
-    void store_object(std::unique_ptr<rocktree_object> object) const;
+    void on_state_changed() override;
+    pipeline::job run_fetching();
+    std::string get_full_url() const;
+    utils::http::request_priority get_download_priority();
 };
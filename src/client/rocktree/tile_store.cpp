@@ -0,0 +1,637 @@
+#include <std_include.hpp>
+
+#include "tile_store.hpp"
+
+#include <utils/io.hpp>
+
+namespace
+{
+    constexpr uint32_t record_magic = 0x52534C54; // TLSR
+    constexpr uint32_t tombstone_size = std::numeric_limits<uint32_t>::max();
+
+    constexpr char segment_prefix[] = "segment_";
+    constexpr char segment_extension[] = ".bin";
+
+    struct record_header
+    {
+        uint32_t magic{};
+        uint32_t key_size{};
+        uint32_t data_size{}; // tombstone_size for removed keys
+        XXH32_hash_t hash{};
+    };
+
+    uint64_t get_record_size(const size_t key_size, const uint32_t data_size)
+    {
+        return sizeof(record_header) + key_size + (data_size == tombstone_size ? 0 : data_size);
+    }
+
+    XXH32_hash_t calculate_hash(const std::string_view& key, const std::string_view& data)
+    {
+        return XXH32(data.data(), data.size(), XXH32(key.data(), key.size(), 0x12345678));
+    }
+
+    std::optional<uint32_t> parse_segment_name(const std::filesystem::path& file)
+    {
+        const auto name = file.filename().string();
+        const std::string_view view = name;
+
+        constexpr std::string_view prefix = segment_prefix;
+        constexpr std::string_view extension = segment_extension;
+
+        if (view.size() <= prefix.size() + extension.size() || !view.starts_with(prefix) || !view.ends_with(extension))
+        {
+            return {};
+        }
+
+        uint32_t id = 0;
+        for (const auto c : view.substr(prefix.size(), view.size() - prefix.size() - extension.size()))
+        {
+            if (c < '0' || c > '9')
+            {
+                return {};
+            }
+
+            id = id * 10 + static_cast<uint32_t>(c - '0');
+        }
+
+        return id;
+    }
+}
+
+tile_store::tile_store(std::filesystem::path directory, const uint64_t size_limit)
+    : directory_(std::move(directory)),
+      size_limit_(size_limit)
+{
+    utils::io::create_directory(this->directory_);
+    this->rebuild_index();
+
+    this->compaction_thread_ = utils::thread::joinable_thread([this](const utils::thread::stop_token& token) {
+        this->compaction_loop(token); //
+    });
+}
+
+tile_store::~tile_store()
+{
+    this->compaction_thread_.request_stop();
+
+    {
+        std::lock_guard _{this->mutex_};
+    }
+
+    this->compaction_condition_.notify_all();
+
+    if (this->compaction_thread_.joinable())
+    {
+        this->compaction_thread_.join();
+    }
+}
+
+std::optional<utils::shared_buffer> tile_store::read(const std::string& key)
+{
+    entry location{};
+
+    {
+        std::lock_guard _{this->mutex_};
+
+        const auto it = this->index_.find(key);
+        if (it == this->index_.end())
+        {
+            return {};
+        }
+
+        this->lru_.splice(this->lru_.begin(), this->lru_, it->second.lru);
+        location = it->second;
+    }
+
+    // A compaction can move the record while it is read, its new location is tried once before it counts as a miss
+    for (int attempt = 0; attempt < 2; ++attempt)
+    {
+        auto data = this->read_record(key, location);
+        if (data)
+        {
+            return data;
+        }
+
+        std::lock_guard _{this->mutex_};
+
+        const auto it = this->index_.find(key);
+        if (it == this->index_.end())
+        {
+            return {};
+        }
+
+        if (it->second.segment != location.segment || it->second.offset != location.offset)
+        {
+            location = it->second;
+            continue;
+        }
+
+        // Corrupt or vanished record
+        this->erase_entry(it);
+        return {};
+    }
+
+    return {};
+}
+
+void tile_store::write(const std::string& key, const std::string_view& data)
+{
+    const write_request request{key, utils::shared_buffer{std::string(data)}};
+    this->write(std::span(&request, 1));
+}
+
+void tile_store::write(const std::span<const write_request> requests)
+{
+    std::unique_lock lock{this->mutex_};
+
+    std::vector<std::optional<record_location>> locations{};
+    locations.reserve(requests.size());
+
+    for (const auto& request : requests)
+    {
+        const auto data = request.second.view();
+        locations.emplace_back(this->append_record(request.first, &data));
+    }
+
+    // Records only become visible to readers once they reached the file
+    if (!this->flush_active_segment())
+    {
+        return;
+    }
+
+    for (size_t i = 0; i < requests.size(); ++i)
+    {
+        if (locations[i])
+        {
+            this->insert_entry(requests[i].first, locations[i]->segment, locations[i]->offset,
+                               static_cast<uint32_t>(requests[i].second.size()));
+        }
+    }
+
+    this->enforce_size_limit();
+    this->flush_active_segment();
+
+    const auto needs_compaction = this->find_compaction_candidate().has_value();
+    lock.unlock();
+
+    if (needs_compaction)
+    {
+        this->compaction_condition_.notify_one();
+    }
+}
+
+size_t tile_store::get_entry_count() const
+{
+    std::lock_guard _{this->mutex_};
+    return this->index_.size();
+}
+
+uint64_t tile_store::get_size() const
+{
+    std::lock_guard _{this->mutex_};
+    return this->live_bytes_;
+}
+
+std::filesystem::path tile_store::get_segment_path(const uint32_t segment) const
+{
+    return this->directory_ / (segment_prefix + std::to_string(segment) + segment_extension);
+}
+
+std::shared_ptr<utils::mapped_file> tile_store::get_mapping(const uint32_t segment, const uint64_t required_size)
+{
+    std::lock_guard _{this->mapping_mutex_};
+
+    auto& mapping = this->mappings_[segment];
+
+    // Segments only ever grow, the active one has to be mapped again once readers reach past the old end
+    if (!mapping || mapping->size() < required_size)
+    {
+        mapping = utils::mapped_file::open(this->get_segment_path(segment));
+    }
+
+    if (!mapping || mapping->size() < required_size)
+    {
+        this->mappings_.erase(segment);
+        return {};
+    }
+
+    return mapping;
+}
+
+std::optional<utils::shared_buffer> tile_store::read_record(const std::string& key, const entry& location)
+{
+    const auto record_size = get_record_size(key.size(), location.size);
+    const auto mapping = this->get_mapping(location.segment, location.offset + record_size);
+
+    if (mapping)
+    {
+        const auto* record = mapping->data() + location.offset;
+
+        record_header header{};
+        memcpy(&header, record, sizeof(header));
+
+        const std::string_view stored_key(reinterpret_cast<const char*>(record + sizeof(header)), key.size());
+        const std::string_view data(stored_key.data() + stored_key.size(), location.size);
+
+        if (header.magic != record_magic || header.key_size != key.size() || header.data_size != location.size || stored_key != key ||
+            calculate_hash(stored_key, data) != header.hash)
+        {
+            return {};
+        }
+
+        return mapping->slice(location.offset + sizeof(header) + key.size(), location.size);
+    }
+
+    // Mapping can fail when running out of address space, read the record into a pooled buffer instead
+    std::ifstream file(this->get_segment_path(location.segment), std::ios::binary);
+    file.seekg(static_cast<std::streamoff>(location.offset));
+
+    record_header header{};
+    if (!file.read(reinterpret_cast<char*>(&header), sizeof(header)) || header.magic != record_magic ||
+        header.key_size != key.size() || header.data_size != location.size)
+    {
+        return {};
+    }
+
+    std::string stored_key(header.key_size, '\0');
+    utils::buffer_builder builder{};
+    auto* data = builder.extend(header.data_size);
+
+    if (!file.read(stored_key.data(), static_cast<std::streamsize>(stored_key.size())) ||
+        !file.read(reinterpret_cast<char*>(data), static_cast<std::streamsize>(header.data_size)) || stored_key != key)
+    {
+        return {};
+    }
+
+    auto buffer = builder.finish();
+    if (calculate_hash(stored_key, buffer.view()) != header.hash)
+    {
+        return {};
+    }
+
+    return buffer;
+}
+
+void tile_store::rebuild_index()
+{
+    std::vector<uint32_t> segment_ids{};
+
+    for (const auto& file : utils::io::list_files(this->directory_))
+    {
+        const auto id = parse_segment_name(file);
+        if (id)
+        {
+            segment_ids.push_back(*id);
+        }
+    }
+
+    std::ranges::sort(segment_ids);
+
+    for (size_t i = 0; i < segment_ids.size(); ++i)
+    {
+        // Only the newest segment can end in a torn write, older ones were complete once the next one got started
+        const auto is_newest = (i + 1) == segment_ids.size();
+
+        this->segments_[segment_ids[i]] = {};
+        this->segments_[segment_ids[i]].size = this->scan_segment(segment_ids[i], is_newest);
+    }
+
+    if (segment_ids.empty())
+    {
+        this->open_segment(1);
+    }
+    else if (this->segments_[segment_ids.back()].size >= segment_size_limit)
+    {
+        this->open_segment(segment_ids.back() + 1);
+    }
+    else
+    {
+        this->open_segment(segment_ids.back());
+    }
+
+    this->enforce_size_limit();
+    this->flush_active_segment();
+}
+
+uint64_t tile_store::scan_segment(const uint32_t segment, const bool verify_data)
+{
+    const auto path = this->get_segment_path(segment);
+
+    std::error_code ec{};
+    const auto file_size = static_cast<uint64_t>(std::filesystem::file_size(path, ec));
+    if (ec)
+    {
+        return 0;
+    }
+
+    std::ifstream file(path, std::ios::binary);
+
+    uint64_t offset = 0;
+    std::string key{};
+    std::string data{};
+
+    while (offset + sizeof(record_header) <= file_size)
+    {
+        record_header header{};
+        if (!file.read(reinterpret_cast<char*>(&header), sizeof(header)) || header.magic != record_magic)
+        {
+            break;
+        }
+
+        const auto is_tombstone = header.data_size == tombstone_size;
+        const auto data_size = is_tombstone ? 0 : header.data_size;
+        const auto record_size = get_record_size(header.key_size, header.data_size);
+
+        if (offset + record_size > file_size)
+        {
+            break;
+        }
+
+        key.resize(header.key_size);
+        if (!file.read(key.data(), static_cast<std::streamsize>(key.size())))
+        {
+            break;
+        }
+
+        if (verify_data)
+        {
+            data.resize(data_size);
+            if (!file.read(data.data(), static_cast<std::streamsize>(data.size())) || calculate_hash(key, data) != header.hash)
+            {
+                break;
+            }
+        }
+        else
+        {
+            file.seekg(data_size, std::ios::cur);
+        }
+
+        if (is_tombstone)
+        {
+            const auto it = this->index_.find(key);
+            if (it != this->index_.end())
+            {
+                this->erase_entry(it);
+            }
+
+            this->segments_[segment].dead_bytes += record_size;
+        }
+        else
+        {
+            this->insert_entry(key, segment, offset, header.data_size);
+        }
+
+        offset += record_size;
+    }
+
+    file.close();
+
+    if (offset < file_size)
+    {
+        std::filesystem::resize_file(path, offset, ec);
+    }
+
+    return offset;
+}
+
+void tile_store::open_segment(const uint32_t segment)
+{
+    this->active_file_.close();
+    this->active_segment_ = segment;
+    this->segments_.try_emplace(segment);
+    this->active_file_.open(this->get_segment_path(segment), std::ios::binary | std::ios::app);
+}
+
+std::optional<tile_store::record_location> tile_store::append_record(const std::string_view& key, const std::string_view* data)
+{
+    if (this->segments_[this->active_segment_].size >= segment_size_limit)
+    {
+        this->open_segment(this->active_segment_ + 1);
+    }
+
+    if (!this->active_file_)
+    {
+        return {};
+    }
+
+    const auto value = data ? *data : std::string_view{};
+
+    record_header header{};
+    header.magic = record_magic;
+    header.key_size = static_cast<uint32_t>(key.size());
+    header.data_size = data ? static_cast<uint32_t>(value.size()) : tombstone_size;
+    header.hash = calculate_hash(key, value);
+
+    this->active_file_.write(reinterpret_cast<const char*>(&header), sizeof(header));
+    this->active_file_.write(key.data(), static_cast<std::streamsize>(key.size()));
+    this->active_file_.write(value.data(), static_cast<std::streamsize>(value.size()));
+
+    auto& segment = this->segments_[this->active_segment_];
+    const record_location location{this->active_segment_, segment.size};
+    segment.size += get_record_size(key.size(), header.data_size);
+
+    if (!data)
+    {
+        segment.dead_bytes += get_record_size(key.size(), header.data_size);
+    }
+
+    return location;
+}
+
+bool tile_store::flush_active_segment()
+{
+    this->active_file_.flush();
+
+    if (this->active_file_)
+    {
+        return true;
+    }
+
+    // A partial record would shift every following offset, continue in a fresh segment instead
+    this->open_segment(this->active_segment_ + 1);
+    return false;
+}
+
+void tile_store::insert_entry(const std::string& key, const uint32_t segment, const uint64_t offset, const uint32_t size)
+{
+    const auto it = this->index_.find(key);
+    if (it != this->index_.end())
+    {
+        this->erase_entry(it);
+    }
+
+    this->lru_.push_front(key);
+    this->index_[key] = {segment, offset, size, this->lru_.begin()};
+    this->live_bytes_ += get_record_size(key.size(), size);
+}
+
+void tile_store::erase_entry(const std::unordered_map<std::string, entry>::iterator entry)
+{
+    const auto record_size = get_record_size(entry->first.size(), entry->second.size);
+
+    this->segments_[entry->second.segment].dead_bytes += record_size;
+    this->live_bytes_ -= record_size;
+
+    this->lru_.erase(entry->second.lru);
+    this->index_.erase(entry);
+}
+
+void tile_store::enforce_size_limit()
+{
+    while (this->live_bytes_ > this->size_limit_ && !this->lru_.empty())
+    {
+        const auto it = this->index_.find(this->lru_.back());
+
+        // Evictions are persisted, otherwise the next index rebuild would resurrect the entry
+        this->append_record(it->first, nullptr);
+        this->erase_entry(it);
+    }
+}
+
+std::optional<uint32_t> tile_store::find_compaction_candidate() const
+{
+    for (const auto& [id, segment] : this->segments_)
+    {
+        if (id != this->active_segment_ && segment.dead_bytes * 2 >= segment.size)
+        {
+            return id;
+        }
+    }
+
+    return {};
+}
+
+void tile_store::compaction_loop(const utils::thread::stop_token& token)
+{
+    while (!token.stop_requested())
+    {
+        std::optional<uint32_t> candidate{};
+
+        {
+            std::unique_lock lock{this->mutex_};
+            this->compaction_condition_.wait_for(lock, std::chrono::seconds(5), [&] {
+                candidate = this->find_compaction_candidate();
+                return token.stop_requested() || candidate.has_value();
+            });
+        }
+
+        if (candidate && !token.stop_requested())
+        {
+            this->compact_segment(*candidate);
+        }
+
+        this->remove_segment_files();
+    }
+}
+
+void tile_store::compact_segment(const uint32_t segment)
+{
+    const auto mapping = utils::mapped_file::open(this->get_segment_path(segment));
+    const auto data = mapping ? std::string_view(reinterpret_cast<const char*>(mapping->data()), mapping->size()) : std::string_view{};
+
+    uint64_t offset = 0;
+
+    while (offset + sizeof(record_header) <= data.size())
+    {
+        record_header header{};
+        memcpy(&header, data.data() + offset, sizeof(header));
+
+        if (header.magic != record_magic)
+        {
+            break;
+        }
+
+        const auto is_tombstone = header.data_size == tombstone_size;
+        const auto record_size = get_record_size(header.key_size, header.data_size);
+
+        if (offset + record_size > data.size())
+        {
+            break;
+        }
+
+        const std::string key(data.data() + offset + sizeof(header), header.key_size);
+        const std::string_view value(data.data() + offset + sizeof(header) + header.key_size, is_tombstone ? 0 : header.data_size);
+
+        std::lock_guard _{this->mutex_};
+
+        const auto it = this->index_.find(key);
+
+        if (is_tombstone)
+        {
+            // Older segments may still hold the removed record, so the tombstone has to outlive them
+            if (it == this->index_.end() && this->segments_.begin()->first < segment)
+            {
+                this->append_record(key, nullptr);
+                this->flush_active_segment();
+            }
+        }
+        else if (it != this->index_.end() && it->second.segment == segment && it->second.offset == offset)
+        {
+            const auto location = calculate_hash(key, value) == header.hash ? this->append_record(key, &value) : std::nullopt;
+            if (location && this->flush_active_segment())
+            {
+                it->second.segment = location->segment;
+                it->second.offset = location->offset;
+            }
+            else
+            {
+                this->erase_entry(it);
+            }
+        }
+
+        offset += record_size;
+    }
+
+    std::lock_guard _{this->mutex_};
+
+    // Entries behind an unreadable tail cannot be moved anymore
+    if (offset < data.size() || data.empty())
+    {
+        for (auto it = this->index_.begin(); it != this->index_.end();)
+        {
+            const auto current = it++;
+            if (current->second.segment == segment)
+            {
+                this->erase_entry(current);
+            }
+        }
+    }
+
+    this->segments_.erase(segment);
+    this->pending_removals_.push_back(segment);
+}
+
+void tile_store::remove_segment_files()
+{
+    std::vector<uint32_t> removals{};
+
+    {
+        std::lock_guard _{this->mutex_};
+        removals.swap(this->pending_removals_);
+    }
+
+    std::vector<uint32_t> failed{};
+
+    for (const auto segment : removals)
+    {
+        {
+            std::lock_guard _{this->mapping_mutex_};
+            this->mappings_.erase(segment);
+        }
+
+        // Files still opened or mapped by readers can not be removed on every platform, try again later
+        std::error_code ec{};
+        std::filesystem::remove(this->get_segment_path(segment), ec);
+
+        if (ec)
+        {
+            failed.push_back(segment);
+        }
+    }
+
+    if (!failed.empty())
+    {
+        std::lock_guard _{this->mutex_};
+        this->pending_removals_.insert(this->pending_removals_.end(), failed.begin(), failed.end());
+    }
+}
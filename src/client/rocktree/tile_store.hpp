@@ -0,0 +1,97 @@
+#pragma once
+
+#include <utils/thread.hpp>
+#include <utils/mapped_file.hpp>
+
+// Packs cached objects into append-only segment files and keeps an in-memory index of all keys.
+// Misses are answered from the index, the filesystem is only touched for hits and writes.
+class tile_store
+{
+  public:
+    static constexpr uint64_t default_size_limit = 4ull << 30;
+    static constexpr uint64_t segment_size_limit = 64ull << 20;
+
+    tile_store(std::filesystem::path directory, uint64_t size_limit = default_size_limit);
+    ~tile_store();
+
+    tile_store(tile_store&&) = delete;
+    tile_store(const tile_store&) = delete;
+    tile_store& operator=(tile_store&&) = delete;
+    tile_store& operator=(const tile_store&) = delete;
+
+    using write_request = std::pair<std::string, utils::shared_buffer>;
+
+    // Hits are slices of a mapped segment, they stay valid after the segment got compacted away
+    std::optional<utils::shared_buffer> read(const std::string& key);
+    void write(const std::string& key, const std::string_view& data);
+
+    // Appends all records under one lock and makes them visible after a single flush
+    void write(std::span<const write_request> requests);
+
+    size_t get_entry_count() const;
+    uint64_t get_size() const;
+
+  private:
+    using lru_list = std::list<std::string>;
+
+    struct entry
+    {
+        uint32_t segment{};
+        uint64_t offset{};
+        uint32_t size{};
+        lru_list::iterator lru{};
+    };
+
+    struct record_location
+    {
+        uint32_t segment{};
+        uint64_t offset{};
+    };
+
+    struct segment
+    {
+        uint64_t size{};
+        uint64_t dead_bytes{};
+    };
+
+    std::filesystem::path directory_{};
+    uint64_t size_limit_{};
+
+    mutable std::mutex mutex_{};
+    std::condition_variable compaction_condition_{};
+
+    std::unordered_map<std::string, entry> index_{};
+    lru_list lru_{}; // most recently used first
+    std::map<uint32_t, segment> segments_{};
+    std::vector<uint32_t> pending_removals_{};
+    uint64_t live_bytes_{};
+
+    uint32_t active_segment_{};
+    std::ofstream active_file_{};
+
+    std::mutex mapping_mutex_{};
+    std::unordered_map<uint32_t, std::shared_ptr<utils::mapped_file>> mappings_{};
+
+    utils::thread::joinable_thread compaction_thread_{};
+
+    std::filesystem::path get_segment_path(uint32_t segment) const;
+
+    std::shared_ptr<utils::mapped_file> get_mapping(uint32_t segment, uint64_t required_size);
+    std::optional<utils::shared_buffer> read_record(const std::string& key, const entry& location);
+
+    void rebuild_index();
+    uint64_t scan_segment(uint32_t segment, bool verify_data);
+
+    void open_segment(uint32_t segment);
+    std::optional<record_location> append_record(const std::string_view& key, const std::string_view* data);
+    bool flush_active_segment();
+
+    void insert_entry(const std::string& key, uint32_t segment, uint64_t offset, uint32_t size);
+    void erase_entry(std::unordered_map<std::string, entry>::iterator entry);
+    void enforce_size_limit();
+
+    std::optional<uint32_t> find_compaction_candidate() const;
+    void compaction_loop(const utils::thread::stop_token& token);
+    void compact_segment(uint32_t segment);
+    void remove_segment_files();
+};
@@ -0,0 +1,558 @@
+#include <std_include.hpp>
+
+#include "wire_format.hpp"
+
+namespace wire_format
+{
+    namespace
+    {
+        // Field numbers from rocktree.proto
+        namespace node_data_fields
+        {
+            constexpr uint32_t matrix_globe_from_mesh = 1;
+            constexpr uint32_t meshes = 2;
+            constexpr uint32_t for_normals = 8;
+        }
+
+        namespace mesh_fields
+        {
+            constexpr uint32_t vertices = 1;
+            constexpr uint32_t indices = 3;
+            constexpr uint32_t texture = 6;
+            constexpr uint32_t texture_coordinates = 7;
+            constexpr uint32_t layer_and_octant_counts = 8;
+            constexpr uint32_t uv_offset_and_scale = 10;
+            constexpr uint32_t normals = 11;
+        }
+
+        namespace texture_fields
+        {
+            constexpr uint32_t data = 1;
+            constexpr uint32_t format = 2;
+            constexpr uint32_t width = 3;
+            constexpr uint32_t height = 4;
+        }
+
+        namespace bulk_metadata_fields
+        {
+            constexpr uint32_t node_metadata = 1;
+            constexpr uint32_t head_node_key = 2;
+            constexpr uint32_t head_node_center = 3;
+            constexpr uint32_t meters_per_texel = 4;
+            constexpr uint32_t default_imagery_epoch = 5;
+            constexpr uint32_t default_available_texture_formats = 6;
+        }
+
+        namespace node_key_fields
+        {
+            constexpr uint32_t epoch = 2;
+        }
+
+        namespace node_metadata_fields
+        {
+            constexpr uint32_t path_and_flags = 1;
+            constexpr uint32_t epoch = 2;
+            constexpr uint32_t oriented_bounding_box = 3;
+            constexpr uint32_t meters_per_texel = 4;
+            constexpr uint32_t bulk_metadata_epoch = 5;
+            constexpr uint32_t imagery_epoch = 7;
+            constexpr uint32_t available_texture_formats = 8;
+        }
+
+        bool is_varint(const field& f)
+        {
+            return f.type == wire_type::varint;
+        }
+
+        bool is_bytes(const field& f)
+        {
+            return f.type == wire_type::length_delimited;
+        }
+
+        template <typename T>
+        bool is_packed(const field& f)
+        {
+            return is_bytes(f) && f.data.size() % sizeof(T) == 0;
+        }
+
+        float get_float(const field& f)
+        {
+            const auto bits = static_cast<uint32_t>(f.value);
+
+            float value{};
+            memcpy(&value, &bits, sizeof(value));
+            return value;
+        }
+
+        std::optional<texture_view> parse_texture(const bytes data)
+        {
+            texture_view texture{};
+
+            reader r{data};
+            field f{};
+
+            while (r.next(f))
+            {
+                switch (f.number)
+                {
+                case texture_fields::data:
+                    if (!is_bytes(f))
+                    {
+                        return {};
+                    }
+
+                    if (texture.data_count++ == 0)
+                    {
+                        texture.data = f.data;
+                    }
+                    break;
+                case texture_fields::format:
+                    if (!is_varint(f))
+                    {
+                        return {};
+                    }
+
+                    texture.format = static_cast<uint32_t>(f.value);
+                    break;
+                case texture_fields::width:
+                    if (!is_varint(f))
+                    {
+                        return {};
+                    }
+
+                    texture.width = static_cast<uint32_t>(f.value);
+                    break;
+                case texture_fields::height:
+                    if (!is_varint(f))
+                    {
+                        return {};
+                    }
+
+                    texture.height = static_cast<uint32_t>(f.value);
+                    break;
+                default:
+                    break;
+                }
+            }
+
+            if (r.failed())
+            {
+                return {};
+            }
+
+            return texture;
+        }
+
+        std::optional<uint32_t> parse_node_key_epoch(const bytes data, const uint32_t current)
+        {
+            auto epoch = current;
+
+            reader r{data};
+            field f{};
+
+            while (r.next(f))
+            {
+                if (f.number == node_key_fields::epoch)
+                {
+                    if (!is_varint(f))
+                    {
+                        return {};
+                    }
+
+                    epoch = static_cast<uint32_t>(f.value);
+                }
+            }
+
+            if (r.failed())
+            {
+                return {};
+            }
+
+            return epoch;
+        }
+    }
+
+    bool reader::next(field& f)
+    {
+        if (this->failed_ || this->offset_ >= this->data_.size())
+        {
+            return false;
+        }
+
+        uint64_t tag{};
+        if (!this->read_varint(tag) || (tag >> 3) == 0 || (tag >> 3) > std::numeric_limits<uint32_t>::max())
+        {
+            this->failed_ = true;
+            return false;
+        }
+
+        f.number = static_cast<uint32_t>(tag >> 3);
+        f.type = static_cast<wire_type>(tag & 7);
+        f.value = 0;
+        f.data = {};
+
+        const auto remaining = this->data_.size() - this->offset_;
+
+        switch (f.type)
+        {
+        case wire_type::varint:
+            if (!this->read_varint(f.value))
+            {
+                this->failed_ = true;
+                return false;
+            }
+
+            return true;
+        case wire_type::fixed64:
+            if (remaining < sizeof(uint64_t))
+            {
+                break;
+            }
+
+            memcpy(&f.value, this->data_.data() + this->offset_, sizeof(uint64_t));
+            this->offset_ += sizeof(uint64_t);
+            return true;
+        case wire_type::fixed32: {
+            if (remaining < sizeof(uint32_t))
+            {
+                break;
+            }
+
+            uint32_t value{};
+            memcpy(&value, this->data_.data() + this->offset_, sizeof(value));
+            this->offset_ += sizeof(value);
+
+            f.value = value;
+            return true;
+        }
+        case wire_type::length_delimited: {
+            uint64_t length{};
+            if (!this->read_varint(length) || length > this->data_.size() - this->offset_)
+            {
+                break;
+            }
+
+            f.data = this->data_.subspan(this->offset_, static_cast<size_t>(length));
+            this->offset_ += static_cast<size_t>(length);
+            return true;
+        }
+        default:
+            // Groups are not used by any rocktree message
+            break;
+        }
+
+        this->failed_ = true;
+        return false;
+    }
+
+    bool reader::read_varint(uint64_t& value)
+    {
+        value = 0;
+
+        for (uint32_t shift = 0; shift < 64 && this->offset_ < this->data_.size(); shift += 7)
+        {
+            const auto byte = this->data_[this->offset_++];
+            value |= static_cast<uint64_t>(byte & 0x7F) << shift;
+
+            if (!(byte & 0x80))
+            {
+                return true;
+            }
+        }
+
+        return false;
+    }
+
+    repeated_field::iterator::iterator(const bytes message, const uint32_t number)
+        : reader_(message),
+          number_(number),
+          at_end_(false)
+    {
+        ++(*this);
+    }
+
+    repeated_field::iterator& repeated_field::iterator::operator++()
+    {
+        while (this->reader_.next(this->current_))
+        {
+            if (this->current_.number == this->number_ && is_bytes(this->current_))
+            {
+                return *this;
+            }
+        }
+
+        this->at_end_ = true;
+        return *this;
+    }
+
+    repeated_field::iterator repeated_field::iterator::operator++(int)
+    {
+        auto previous = *this;
+        ++(*this);
+        return previous;
+    }
+
+    std::optional<node_data_view> parse_node_data(const bytes data)
+    {
+        node_data_view node_data{};
+        node_data.meshes = repeated_field{data, node_data_fields::meshes};
+
+        reader r{data};
+        field f{};
+
+        while (r.next(f))
+        {
+            switch (f.number)
+            {
+            case node_data_fields::matrix_globe_from_mesh:
+                if (!is_packed<double>(f))
+                {
+                    return {};
+                }
+
+                node_data.matrix_globe_from_mesh = packed_array<double>{f.data};
+                break;
+            case node_data_fields::meshes:
+                if (!is_bytes(f))
+                {
+                    return {};
+                }
+
+                ++node_data.mesh_count;
+                break;
+            case node_data_fields::for_normals:
+                if (!is_bytes(f))
+                {
+                    return {};
+                }
+
+                node_data.for_normals = f.data;
+                break;
+            default:
+                break;
+            }
+        }
+
+        if (r.failed())
+        {
+            return {};
+        }
+
+        return node_data;
+    }
+
+    std::optional<mesh_view> parse_mesh(const bytes data)
+    {
+        mesh_view mesh{};
+
+        reader r{data};
+        field f{};
+
+        while (r.next(f))
+        {
+            bytes* target = nullptr;
+
+            switch (f.number)
+            {
+            case mesh_fields::vertices:
+                target = &mesh.vertices;
+                break;
+            case mesh_fields::indices:
+                target = &mesh.indices;
+                break;
+            case mesh_fields::texture_coordinates:
+                target = &mesh.texture_coordinates;
+                break;
+            case mesh_fields::layer_and_octant_counts:
+                target = &mesh.layer_and_octant_counts;
+                break;
+            case mesh_fields::normals:
+                target = &mesh.normals;
+                break;
+            case mesh_fields::uv_offset_and_scale:
+                if (!is_packed<float>(f))
+                {
+                    return {};
+                }
+
+                mesh.uv_offset_and_scale = packed_array<float>{f.data};
+                continue;
+            case mesh_fields::texture:
+                if (!is_bytes(f))
+                {
+                    return {};
+                }
+
+                if (mesh.texture_count++ == 0)
+                {
+                    const auto texture = parse_texture(f.data);
+                    if (!texture)
+                    {
+                        return {};
+                    }
+
+                    mesh.texture = *texture;
+                }
+                continue;
+            default:
+                continue;
+            }
+
+            if (!is_bytes(f))
+            {
+                return {};
+            }
+
+            *target = f.data;
+        }
+
+        if (r.failed())
+        {
+            return {};
+        }
+
+        return mesh;
+    }
+
+    std::optional<bulk_metadata_view> parse_bulk_metadata(const bytes data)
+    {
+        bulk_metadata_view bulk_metadata{};
+        bulk_metadata.node_metadata = repeated_field{data, bulk_metadata_fields::node_metadata};
+
+        reader r{data};
+        field f{};
+
+        while (r.next(f))
+        {
+            switch (f.number)
+            {
+            case bulk_metadata_fields::node_metadata:
+                if (!is_bytes(f))
+                {
+                    return {};
+                }
+                break;
+            case bulk_metadata_fields::head_node_key: {
+                const auto epoch = is_bytes(f) ? parse_node_key_epoch(f.data, bulk_metadata.head_node_epoch) : std::nullopt;
+                if (!epoch)
+                {
+                    return {};
+                }
+
+                bulk_metadata.head_node_epoch = *epoch;
+                break;
+            }
+            case bulk_metadata_fields::head_node_center:
+                if (!is_packed<double>(f))
+                {
+                    return {};
+                }
+
+                bulk_metadata.head_node_center = packed_array<double>{f.data};
+                break;
+            case bulk_metadata_fields::meters_per_texel:
+                if (!is_packed<float>(f))
+                {
+                    return {};
+                }
+
+                bulk_metadata.meters_per_texel = packed_array<float>{f.data};
+                break;
+            case bulk_metadata_fields::default_imagery_epoch:
+                if (!is_varint(f))
+                {
+                    return {};
+                }
+
+                bulk_metadata.default_imagery_epoch = static_cast<uint32_t>(f.value);
+                break;
+            case bulk_metadata_fields::default_available_texture_formats:
+                if (!is_varint(f))
+                {
+                    return {};
+                }
+
+                bulk_metadata.default_available_texture_formats = static_cast<uint32_t>(f.value);
+                break;
+            default:
+                break;
+            }
+        }
+
+        if (r.failed())
+        {
+            return {};
+        }
+
+        return bulk_metadata;
+    }
+
+    std::optional<node_metadata_view> parse_node_metadata(const bytes data)
+    {
+        node_metadata_view node_metadata{};
+
+        reader r{data};
+        field f{};
+
+        while (r.next(f))
+        {
+            std::optional<uint32_t>* target = nullptr;
+
+            switch (f.number)
+            {
+            case node_metadata_fields::path_and_flags:
+                if (!is_varint(f))
+                {
+                    return {};
+                }
+
+                node_metadata.path_and_flags = static_cast<uint32_t>(f.value);
+                continue;
+            case node_metadata_fields::oriented_bounding_box:
+                if (!is_bytes(f))
+                {
+                    return {};
+                }
+
+                node_metadata.oriented_bounding_box = f.data;
+                continue;
+            case node_metadata_fields::meters_per_texel:
+                if (f.type != wire_type::fixed32)
+                {
+                    return {};
+                }
+
+                node_metadata.meters_per_texel = get_float(f);
+                continue;
+            case node_metadata_fields::epoch:
+                target = &node_metadata.epoch;
+                break;
+            case node_metadata_fields::bulk_metadata_epoch:
+                target = &node_metadata.bulk_metadata_epoch;
+                break;
+            case node_metadata_fields::imagery_epoch:
+                target = &node_metadata.imagery_epoch;
+                break;
+            case node_metadata_fields::available_texture_formats:
+                target = &node_metadata.available_texture_formats;
+                break;
+            default:
+                continue;
+            }
+
+            if (!is_varint(f))
+            {
+                return {};
+            }
+
+            *target = static_cast<uint32_t>(f.value);
+        }
+
+        if (r.failed())
+        {
+            return {};
+        }
+
+        return node_metadata;
+    }
+}
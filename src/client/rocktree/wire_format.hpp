@@ -0,0 +1,195 @@
+#pragma once
+
+// Reads the rocktree protobuf messages straight from the payload. Nothing is allocated, bytes fields are spans into
+// the payload and fields the decoders never look at (water and overlay meshes, KML boxes, ...) are skipped unparsed.
+namespace wire_format
+{
+    using bytes = std::span<const uint8_t>;
+
+    enum class wire_type : uint8_t
+    {
+        varint = 0,
+        fixed64 = 1,
+        length_delimited = 2,
+        fixed32 = 5,
+    };
+
+    struct field
+    {
+        uint32_t number{};
+        wire_type type{};
+        uint64_t value{}; // varint and fixed fields
+        bytes data{};     // length delimited fields
+    };
+
+    class reader
+    {
+      public:
+        explicit reader(bytes data)
+            : data_(data)
+        {
+        }
+
+        // Returns false at the end of the message or on malformed input, failed() tells them apart
+        bool next(field& f);
+
+        bool failed() const
+        {
+            return this->failed_;
+        }
+
+      private:
+        bytes data_{};
+        size_t offset_{};
+        bool failed_{false};
+
+        bool read_varint(uint64_t& value);
+    };
+
+    // Repeated numbers as declared in rocktree.proto, only the packed encoding is accepted
+    template <typename T>
+    class packed_array
+    {
+      public:
+        packed_array() = default;
+
+        explicit packed_array(const bytes data)
+            : data_(data)
+        {
+        }
+
+        size_t size() const
+        {
+            return this->data_.size() / sizeof(T);
+        }
+
+        T operator[](const size_t index) const
+        {
+            T value{};
+            memcpy(&value, this->data_.data() + index * sizeof(T), sizeof(T));
+            return value;
+        }
+
+        T get(const size_t index, const T fallback = {}) const
+        {
+            return index < this->size() ? (*this)[index] : fallback;
+        }
+
+      private:
+        bytes data_{};
+    };
+
+    // Walks all entries of a repeated message field, the entries are parsed by the caller
+    class repeated_field
+    {
+      public:
+        class iterator
+        {
+          public:
+            using value_type = bytes;
+            using difference_type = std::ptrdiff_t;
+
+            iterator() = default;
+            iterator(bytes message, uint32_t number);
+
+            bytes operator*() const
+            {
+                return this->current_.data;
+            }
+
+            iterator& operator++();
+            iterator operator++(int);
+
+            bool operator==(const iterator& other) const
+            {
+                return this->at_end_ == other.at_end_;
+            }
+
+          private:
+            reader reader_{{}};
+            uint32_t number_{};
+            field current_{};
+            bool at_end_{true};
+        };
+
+        repeated_field() = default;
+
+        repeated_field(const bytes message, const uint32_t number)
+            : message_(message),
+              number_(number)
+        {
+        }
+
+        iterator begin() const
+        {
+            return {this->message_, this->number_};
+        }
+
+        iterator end() const
+        {
+            return {};
+        }
+
+      private:
+        bytes message_{};
+        uint32_t number_{};
+    };
+
+    struct texture_view
+    {
+        bytes data{}; // first entry of the repeated data field
+        size_t data_count{};
+        uint32_t format{};
+        uint32_t width{256};
+        uint32_t height{256};
+    };
+
+    struct mesh_view
+    {
+        bytes vertices{};
+        bytes texture_coordinates{};
+        bytes indices{};
+        bytes layer_and_octant_counts{};
+        bytes normals{};
+        packed_array<float> uv_offset_and_scale{};
+
+        texture_view texture{}; // only the first texture is parsed
+        size_t texture_count{};
+    };
+
+    struct node_data_view
+    {
+        packed_array<double> matrix_globe_from_mesh{};
+        bytes for_normals{};
+        repeated_field meshes{};
+        size_t mesh_count{};
+    };
+
+    struct node_metadata_view
+    {
+        uint32_t path_and_flags{};
+        std::optional<uint32_t> epoch{};
+        std::optional<uint32_t> bulk_metadata_epoch{};
+        std::optional<bytes> oriented_bounding_box{};
+        std::optional<float> meters_per_texel{};
+        std::optional<uint32_t> imagery_epoch{};
+        std::optional<uint32_t> available_texture_formats{};
+    };
+
+    struct bulk_metadata_view
+    {
+        repeated_field node_metadata{};
+        uint32_t head_node_epoch{};
+        packed_array<double> head_node_center{};
+        packed_array<float> meters_per_texel{};
+        uint32_t default_imagery_epoch{};
+        uint32_t default_available_texture_formats{};
+    };
+
+    // Only the top level is validated, nested messages are checked once they get parsed
+    std::optional<node_data_view> parse_node_data(bytes data);
+    std::optional<mesh_view> parse_mesh(bytes data);
+
+    std::optional<bulk_metadata_view> parse_bulk_metadata(bytes data);
+    std::optional<node_metadata_view> parse_node_metadata(bytes data);
+}
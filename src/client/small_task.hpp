@@ -0,0 +1,115 @@
+#pragma once
+
+// Move-only stand-in for std::function<void()>. Callables of up to inline_size bytes live inside the task, which covers
+// the lambdas the rocktree schedules, larger ones are moved to the heap.
+class small_task
+{
+  public:
+    static constexpr size_t inline_size = 112;
+
+    small_task() = default;
+
+    template <typename F>
+        requires(!std::is_same_v<std::decay_t<F>, small_task> && std::is_invocable_v<std::decay_t<F>&>)
+    small_task(F&& f)
+    {
+        using callable = std::decay_t<F>;
+
+        if constexpr (is_stored_inline<callable>())
+        {
+            new (this->storage_) callable(std::forward<F>(f));
+            this->operations_ = &inline_operations<callable>;
+        }
+        else
+        {
+            *reinterpret_cast<callable**>(this->storage_) = new callable(std::forward<F>(f));
+            this->operations_ = &heap_operations<callable>;
+        }
+    }
+
+    small_task(small_task&& other) noexcept
+    {
+        this->take(other);
+    }
+
+    small_task& operator=(small_task&& other) noexcept
+    {
+        if (this != &other)
+        {
+            this->reset();
+            this->take(other);
+        }
+
+        return *this;
+    }
+
+    small_task(const small_task&) = delete;
+    small_task& operator=(const small_task&) = delete;
+
+    ~small_task()
+    {
+        this->reset();
+    }
+
+    explicit operator bool() const
+    {
+        return this->operations_ != nullptr;
+    }
+
+    void operator()()
+    {
+        this->operations_->invoke(this->storage_);
+    }
+
+  private:
+    struct operations
+    {
+        void (*invoke)(std::byte* storage);
+        void (*move)(std::byte* destination, std::byte* source) noexcept; // leaves source destroyed
+        void (*destroy)(std::byte* storage) noexcept;
+    };
+
+    template <typename F>
+    static constexpr bool is_stored_inline()
+    {
+        return sizeof(F) <= inline_size && alignof(F) <= alignof(std::max_align_t) && std::is_nothrow_move_constructible_v<F>;
+    }
+
+    template <typename F>
+    static constexpr operations inline_operations{
+        [](std::byte* storage) { (*std::launder(reinterpret_cast<F*>(storage)))(); },
+        [](std::byte* destination, std::byte* source) noexcept {
+            auto* f = std::launder(reinterpret_cast<F*>(source));
+            new (destination) F(std::move(*f));
+            f->~F();
+        },
+        [](std::byte* storage) noexcept { std::launder(reinterpret_cast<F*>(storage))->~F(); },
+    };
+
+    template <typename F>
+    static constexpr operations heap_operations{
+        [](std::byte* storage) { (**reinterpret_cast<F**>(storage))(); },
+        [](std::byte* destination, std::byte* source) noexcept { memcpy(destination, source, sizeof(F*)); },
+        [](std::byte* storage) noexcept { delete *reinterpret_cast<F**>(storage); },
+    };
+
+    alignas(std::max_align_t) std::byte storage_[inline_size];
+    const operations* operations_{};
+
+    void take(small_task& other) noexcept
+    {
+        if (other.operations_)
+        {
+            other.operations_->move(this->storage_, other.storage_);
+            this->operations_ = std::exchange(other.operations_, nullptr);
+        }
+    }
+
+    void reset() noexcept
+    {
+        if (this->operations_)
+        {
+            std::exchange(this->operations_, nullptr)->destroy(this->storage_);
+        }
+    }
+};
@@ -50,18 +50,21 @@
 #include <queue>
 #include <thread>
 #include <ranges>
+#include <span>
 #include <atomic>
 #include <vector>
 #include <mutex>
 #include <string>
 #include <chrono>
 #include <memory>
+#include <fstream>
 #include <functional>
 #include <filesystem>
 #include <optional>
 #include <stdexcept>
 #include <string_view>
 #include <unordered_set>
+#include <unordered_map>
 #include <condition_variable>
 
 #include <cassert>
@@ -1,18 +1,48 @@
-#include "std_include.hpp"
+#include <std_include.hpp>
 
 #include "task_manager.hpp"
 
 #include <utils/thread.hpp>
 
+namespace
+{
+    struct worker_identity
+    {
+        const task_manager* manager{};
+        size_t index{};
+    };
+
+    thread_local worker_identity current_worker{};
+
+    // Heap order, the front is the task to run next
+    template <typename Entry>
+    bool runs_after(const Entry& a, const Entry& b)
+    {
+        if (a.score != b.score)
+        {
+            return a.score < b.score;
+        }
+
+        return a.sequence > b.sequence;
+    }
+}
+
 task_manager::task_manager(const size_t num_threads)
 {
+    this->workers_.resize(std::max<size_t>(num_threads, 1));
+
+    for (auto& worker : this->workers_)
+    {
+        worker = std::make_unique<task_manager::worker>();
+    }
+
     this->threads_.resize(num_threads);
 
-    for (auto& thread : this->threads_)
+    for (size_t i = 0; i < this->threads_.size(); ++i)
     {
-        thread = utils::thread::create_named_thread("Task Manager", [this] {
+        this->threads_[i] = utils::thread::create_named_thread("Task Manager", [this, i] {
             utils::thread::set_priority(utils::thread::priority::low);
-            this->work();
+            this->work(i);
         });
     }
 }
@@ -22,37 +52,108 @@ task_manager::~task_manager()
     this->stop();
 }
 
-void task_manager::schedule(std::deque<task>& q, task t, const bool is_high_priority_thread)
+void task_manager::schedule(task t, const size_t priority, const bool /*is_high_priority_thread*/)
 {
-    if (is_high_priority_thread)
+    this->schedule(std::move(t), task_options{.priority = priority});
+}
+
+void task_manager::schedule(task t, task_options options)
+{
+    if (this->stop_)
     {
-        std::scoped_lock lock{this->mutex_.high_priority()};
-        q.push_back(std::move(t));
+        if (options.cancelled)
+        {
+            options.cancelled();
+        }
+
+        return;
+    }
+
+    const auto level = std::min((QUEUE_COUNT - 1), options.priority);
+
+    const heap_entry key{
+        .score = options.live_score ? options.live_score->load() : options.score,
+        .sequence = this->next_sequence_++,
+    };
+
+    queued_task entry{
+        .t = std::move(t),
+        .cancelled = std::move(options.cancelled),
+        .token = std::move(options.token),
+        .live_score = options.live_score,
+    };
+
+    // Workers keep what they spawn, the rest is spread over all of them
+    const auto index = current_worker.manager == this ? current_worker.index : (this->next_worker_++ % this->workers_.size());
+    auto& q = this->workers_[index]->queues[level];
+
+    auto is_queued = false;
+
+    {
+        std::lock_guard _{q.mutex};
+
+        // stop() sets the flag before it drains the queues under this lock, a task it would miss is cancelled here instead
+        if (!this->stop_)
+        {
+            auto& heap_key = q.heap.emplace_back(key);
+
+            if (q.free_slots.empty())
+            {
+                heap_key.slot = static_cast<uint32_t>(q.slots.size());
+                q.slots.emplace_back(std::move(entry));
+            }
+            else
+            {
+                heap_key.slot = q.free_slots.back();
+                q.free_slots.pop_back();
+                q.slots[heap_key.slot] = std::move(entry);
+            }
+
+            std::ranges::push_heap(q.heap, runs_after<heap_entry>);
+            ++q.size;
+
+            if (options.live_score)
+            {
+                ++q.live_scores;
+            }
+
+            ++this->task_counts_[level];
+            is_queued = true;
+        }
     }
-    else
+
+    if (!is_queued)
     {
-        std::scoped_lock lock{this->mutex_};
-        q.push_back(std::move(t));
+        if (entry.cancelled)
+        {
+            entry.cancelled();
+        }
+
+        return;
     }
 
-    this->condition_variable_.notify_one();
+    this->wake_worker();
 }
 
-void task_manager::schedule(task t, const size_t priority, const bool is_high_priority_thread)
+void task_manager::update_scores()
 {
-    auto& q = this->queues_.at(std::min((this->queues_.size() - 1), priority));
-    this->schedule(q, std::move(t), is_high_priority_thread);
+    // Re-sorting touches every queued task, once per frame would make frames slower the deeper the queues get
+    const auto now = std::chrono::steady_clock::now();
+    if (now - this->last_score_update_.load() < SCORE_REFRESH_INTERVAL)
+    {
+        return;
+    }
+
+    this->last_score_update_ = now;
+    ++this->score_generation_;
 }
 
 void task_manager::stop()
 {
-    {
-        std::lock_guard _{this->mutex_};
-        this->stop_ = true;
-        this->queues_ = {};
-    }
+    this->stop_ = true;
 
-    this->condition_variable_.notify_all();
+    ++this->wake_counter_;
+    this->wake_counter_.notify_all();
 
     for (auto& thread : this->threads_)
     {
@@ -61,14 +162,49 @@ void task_manager::stop()
             thread.join();
         }
     }
+
+    for (auto& worker : this->workers_)
+    {
+        for (size_t i = 0; i < worker->queues.size(); ++i)
+        {
+            auto& q = worker->queues[i];
+
+            std::vector<queued_task> tasks{};
+
+            {
+                std::lock_guard _{q.mutex};
+                this->task_counts_[i] -= q.heap.size();
+
+                for (const auto& key : q.heap)
+                {
+                    tasks.emplace_back(std::move(q.slots[key.slot]));
+                }
+
+                q.slots.clear();
+                q.heap.clear();
+                q.free_slots.clear();
+                q.size = 0;
+                q.live_scores = 0;
+            }
+
+            // Whoever waits for a queued task gets to clean up
+            for (auto& entry : tasks)
+            {
+                if (entry.cancelled)
+                {
+                    entry.cancelled();
+                }
+            }
+        }
+    }
 }
 
 size_t task_manager::get_tasks() const
 {
     size_t tasks = 0;
-    for (const auto& q : queues_)
+    for (const auto& count : this->task_counts_)
     {
-        tasks += q.size();
+        tasks += count;
     }
 
     return tasks;
@@ -76,67 +212,177 @@ size_t task_manager::get_tasks() const
 
 size_t task_manager::get_tasks(const size_t i) const
 {
-    return this->queues_.at(i).size();
+    return this->task_counts_.at(i);
+}
+
+void task_manager::wake_worker()
+{
+    // The counter changes even without parked workers, so a worker that is about to park sees it and looks again
+    ++this->wake_counter_;
+
+    if (this->parked_workers_ > 0)
+    {
+        this->wake_counter_.notify_one();
+    }
 }
 
-void task_manager::work()
+void task_manager::refresh_scores(task_queue& q, std::vector<queued_task>& discarded)
 {
-    auto should_wake_up = [this] {
-        if (this->stop_)
+    const auto generation = this->score_generation_.load();
+    if (q.score_generation == generation)
+    {
+        return;
+    }
+
+    q.score_generation = generation;
+
+    // Nothing to re-sort, stopped tasks are still dropped once they would run
+    if (q.live_scores == 0)
+    {
+        return;
+    }
+
+    const auto stopped = std::ranges::partition(q.heap, [&q](const heap_entry& key) {
+        return !q.slots[key.slot].token.stop_requested(); //
+    });
+
+    for (const auto& key : stopped)
+    {
+        if (q.slots[key.slot].live_score)
         {
-            return true;
+            --q.live_scores;
         }
 
-        for (const auto& q : queues_)
+        discarded.emplace_back(std::move(q.slots[key.slot]));
+        q.free_slots.push_back(key.slot);
+    }
+
+    q.heap.erase(stopped.begin(), stopped.end());
+
+    for (auto& key : q.heap)
+    {
+        if (const auto* live_score = q.slots[key.slot].live_score)
         {
-            if (!q.empty())
-            {
-                return true;
-            }
+            key.score = live_score->load();
         }
+    }
 
-        return false;
-    };
+    std::ranges::make_heap(q.heap, runs_after<heap_entry>);
+    q.size = q.heap.size();
+}
+
+std::optional<task_manager::queued_task> task_manager::pop_task(task_queue& q, std::vector<queued_task>& discarded)
+{
+    if (q.size == 0)
+    {
+        return std::nullopt;
+    }
+
+    std::lock_guard _{q.mutex};
+
+    this->refresh_scores(q, discarded);
+
+    if (q.heap.empty())
+    {
+        return std::nullopt;
+    }
+
+    std::ranges::pop_heap(q.heap, runs_after<heap_entry>);
+
+    const auto slot = q.heap.back().slot;
+    q.heap.pop_back();
+    q.free_slots.push_back(slot);
+    --q.size;
 
-    while (true)
+    if (q.slots[slot].live_score)
     {
-        std::unique_lock lock{this->mutex_};
+        --q.live_scores;
+    }
+
+    return std::move(q.slots[slot]);
+}
+
+bool task_manager::run_next_task(const size_t index)
+{
+    const auto worker_count = this->workers_.size();
+    std::vector<queued_task> discarded{};
 
-        if (!should_wake_up())
+    const auto run = [](task& t) {
+        try
         {
-            this->condition_variable_.wait_for(lock, 1s, should_wake_up);
+            if (t)
+            {
+                t();
+            }
         }
-
-        if (this->stop_)
+        catch (const std::exception& e)
         {
-            break;
+            puts(e.what());
         }
+    };
 
-        auto* q = &this->queues_.at(0);
-        for (size_t i = 1; q->empty() && i < this->queues_.size(); ++i)
+    const auto finish_discarded = [&](const size_t level) {
+        this->task_counts_[level] -= discarded.size();
+
+        for (auto& entry : discarded)
         {
-            q = &this->queues_.at(i);
+            run(entry.cancelled);
         }
 
-        if (q->empty())
+        const auto had_discarded = !discarded.empty();
+        discarded.clear();
+        return had_discarded;
+    };
+
+    for (size_t level = 0; level < QUEUE_COUNT; ++level)
+    {
+        if (this->task_counts_[level] == 0)
         {
             continue;
         }
 
-        auto task = std::move(q->front());
-        q->pop_front();
+        // Own queue first, then steal from the others, starting with the next worker so thieves spread out
+        for (size_t i = 0; i < worker_count; ++i)
+        {
+            auto entry = this->pop_task(this->workers_[(index + i) % worker_count]->queues[level], discarded);
+            const auto had_discarded = finish_discarded(level);
 
-        lock.unlock();
+            if (!entry)
+            {
+                if (had_discarded)
+                {
+                    return true;
+                }
 
-        try
-        {
-            task();
+                continue;
+            }
+
+            --this->task_counts_[level];
+
+            // Stale work is dropped right before it would run
+            run(entry->token.stop_requested() ? entry->cancelled : entry->t);
+            return true;
         }
-        catch (const std::exception& e)
+    }
+
+    return false;
+}
+
+void task_manager::work(const size_t index)
+{
+    current_worker = {this, index};
+
+    while (!this->stop_)
+    {
+        const auto wake_count = this->wake_counter_.load();
+
+        if (this->run_next_task(index))
         {
-            puts(e.what());
+            continue;
         }
 
-        std::this_thread::yield();
+        ++this->parked_workers_;
+        this->wake_counter_.wait(wake_count);
+        --this->parked_workers_;
     }
 }
@@ -1,6 +1,8 @@
 #pragma once
 #include <utils/http.hpp>
-#include <utils/priority_mutex.hpp>
+#include <utils/thread.hpp>
+
+#include "small_task.hpp"
 
 inline int32_t get_available_threads()
 {
@@ -14,12 +16,25 @@ inline uint32_t get_task_manager_thread_count()
     return static_cast<uint32_t>(std::max(3, get_available_threads()));
 }
 
+// Every worker owns one queue per priority level. Tasks scheduled from a worker stay on its own queues, others are spread
+// round robin, and idle workers steal from the others before they park on an atomic wake counter.
 class task_manager
 {
   public:
     static constexpr size_t QUEUE_COUNT = 4;
+    static constexpr std::chrono::milliseconds SCORE_REFRESH_INTERVAL{100};
+
+    using task = small_task;
 
-    using task = std::function<void()>;
+    // Tasks of a lower priority level run first, within a level the higher score wins and ties keep their order
+    struct task_options
+    {
+        size_t priority{QUEUE_COUNT - 1};
+        double score{std::numeric_limits<double>::max()}; // unscored tasks complete work in flight, so they go first
+        const std::atomic<double>* live_score{};           // replaces score and is read again after update_scores()
+        utils::thread::stop_token token{};                 // a stopped task is discarded and cancelled runs instead
+        task cancelled{};
+    };
 
     task_manager(size_t num_threads = get_task_manager_thread_count());
     ~task_manager();
@@ -29,28 +44,73 @@ class task_manager
     task_manager& operator=(task_manager&&) = delete;
     task_manager& operator=(const task_manager&) = delete;
 
+    // Scheduling never waits on a lock held by the workers, is_high_priority_thread is kept for existing callers
     void schedule(task t, size_t priority = (QUEUE_COUNT - 1), bool is_high_priority_thread = false);
 
+    // live_score has to outlive the task, stop the token before it goes away.
+    // Once the manager is stopping, cancelled runs right away, also for everything that was still queued.
+    void schedule(task t, task_options options);
+
+    // Queued tasks pick up their live scores and drop stopped ones the next time a worker looks at their queue.
+    // Calls within SCORE_REFRESH_INTERVAL of the last refresh are ignored, queues without live scores are never re-sorted.
+    void update_scores();
+
     void stop();
 
     size_t get_tasks() const;
     size_t get_tasks(size_t i) const;
 
-    std::unique_lock<std::recursive_mutex> lock_high_priority()
+  private:
+    struct queued_task
     {
-        return std::unique_lock<std::recursive_mutex>{this->mutex_.high_priority()};
-    }
+        task t{};
+        task cancelled{};
+        utils::thread::stop_token token{};
+        const std::atomic<double>* live_score{};
+    };
 
-  private:
-    bool stop_{false};
+    // Only the keys are moved around by the heap, the tasks stay in their slot
+    struct heap_entry
+    {
+        double score{};
+        uint64_t sequence{};
+        uint32_t slot{};
+    };
+
+    struct task_queue
+    {
+        std::mutex mutex{};
+        std::vector<heap_entry> heap{};
+        std::vector<queued_task> slots{};
+        std::vector<uint32_t> free_slots{};
+        uint64_t score_generation{};
+        size_t live_scores{}; // queued tasks with a live score, a queue without any keeps its order
+        std::atomic<size_t> size{0}; // lets thieves skip empty queues without locking
+    };
 
-    utils::priority_mutex mutex_{};
-    std::condition_variable_any condition_variable_{};
+    struct worker
+    {
+        std::array<task_queue, QUEUE_COUNT> queues{};
+    };
 
-    std::array<std::deque<task>, QUEUE_COUNT> queues_{};
+    std::atomic_bool stop_{false};
+
+    std::vector<std::unique_ptr<worker>> workers_{};
     std::vector<std::thread> threads_{};
 
-    void work();
+    std::array<std::atomic<size_t>, QUEUE_COUNT> task_counts_{};
+    std::atomic<size_t> next_worker_{0};
+    std::atomic<uint64_t> next_sequence_{0};
+    std::atomic<uint64_t> score_generation_{0};
+    std::atomic<std::chrono::steady_clock::time_point> last_score_update_{};
+
+    std::atomic<uint32_t> wake_counter_{0};
+    std::atomic<uint32_t> parked_workers_{0};
+
+    void work(size_t index);
+    bool run_next_task(size_t index);
 
-    void schedule(std::deque<task>& q, task t, bool is_high_priority_thread);
+    std::optional<queued_task> pop_task(task_queue& q, std::vector<queued_task>& discarded);
+    void refresh_scores(task_queue& q, std::vector<queued_task>& discarded);
+    void wake_worker();
 };
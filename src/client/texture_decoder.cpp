@@ -0,0 +1,157 @@
+#include "std_include.hpp"
+
+#include "texture_decoder.hpp"
+
+#include "bc1_encoder.hpp"
+#include "jpeg_decoder.hpp"
+#include "texture_mipmaps.hpp"
+
+#pragma warning(push)
+#pragma warning(disable : 4100)
+#pragma warning(disable : 4127)
+#pragma warning(disable : 4244)
+#pragma warning(disable : 6262)
+
+#include <crn.h>
+
+#pragma warning(pop)
+
+// With MOMO_ENABLE_BC1_TRANSCODE, JPEG tiles are compressed to DXT1 on the decode workers.
+// That cuts texture memory and upload bandwidth by 6x, turning the option off uploads raw RGB.
+
+namespace texture_decoder
+{
+    namespace
+    {
+        bool decode_jpeg(mesh_data& mesh)
+        {
+            const auto& source = mesh.source_texture;
+
+            auto image = jpeg_decoder::decode(source.data, source.scale_shift);
+            if (!image)
+            {
+                return false;
+            }
+
+#ifdef TRANSCODE_JPEG_TO_BC1
+            mesh.texture = bc1::encode(image->pixels.data(), image->width, image->height, 3);
+            mesh.format = texture_format::dxt1;
+#else
+            mesh.texture = std::move(image->pixels);
+            mesh.format = texture_format::rgb;
+#endif
+            mesh.texture_width = image->width;
+            mesh.texture_height = image->height;
+
+            return true;
+        }
+
+        bool decode_crn(mesh_data& mesh)
+        {
+            const auto& source = mesh.source_texture;
+
+            const auto src_size = static_cast<uint32_t>(source.data.size());
+            const auto* src = source.data.data();
+
+            const auto dst_size = crn_get_decompressed_size(src, src_size, 0);
+            if (dst_size != bc1::get_encoded_size(source.width, source.height))
+            {
+                return false;
+            }
+
+            mesh.texture = std::vector<uint8_t>(dst_size);
+            crn_decompress(src, src_size, mesh.texture.data(), dst_size, 0);
+
+            mesh.format = texture_format::dxt1;
+            mesh.texture_width = source.width;
+            mesh.texture_height = source.height;
+
+            return true;
+        }
+
+        // Nothing to decode, the chain only has to be split into its levels
+        bool decode_dxt1_mips(mesh_data& mesh)
+        {
+            const auto& source = mesh.source_texture;
+
+            auto width = source.width;
+            auto height = source.height;
+            if (width <= 0 || height <= 0)
+            {
+                return false;
+            }
+
+            const auto level_count = texture_mipmaps::get_level_count(width, height);
+            mesh.texture_mips.reserve(static_cast<size_t>(level_count - 1));
+
+            size_t offset = 0;
+
+            for (int level = 0; level < level_count; ++level)
+            {
+                const auto size = bc1::get_encoded_size(width, height);
+                if (size > source.data.size() - offset)
+                {
+                    return false;
+                }
+
+                const auto* blocks = source.data.data() + offset;
+                auto& target = level == 0 ? mesh.texture : mesh.texture_mips.emplace_back();
+                target.assign(blocks, blocks + size);
+
+                offset += size;
+                width = std::max(1, width / 2);
+                height = std::max(1, height / 2);
+            }
+
+            mesh.format = texture_format::dxt1;
+            mesh.texture_width = source.width;
+            mesh.texture_height = source.height;
+
+            return offset == source.data.size();
+        }
+    }
+
+    bool decode(mesh_data& mesh)
+    {
+        if (!mesh.texture.empty())
+        {
+            return true;
+        }
+
+        bool decoded = false;
+
+        switch (mesh.source_texture.encoding)
+        {
+        case texture_encoding::jpeg:
+            decoded = decode_jpeg(mesh);
+            break;
+        case texture_encoding::crn_dxt1:
+            decoded = decode_crn(mesh);
+            break;
+        case texture_encoding::dxt1_mips:
+            decoded = decode_dxt1_mips(mesh);
+            break;
+        }
+
+        if (!decoded)
+        {
+            release(mesh);
+            return false;
+        }
+
+        // A cached chain brings its levels along
+        if (mesh.source_texture.encoding != texture_encoding::dxt1_mips)
+        {
+            mesh.texture_mips = texture_mipmaps::generate(mesh.texture, mesh.format, mesh.texture_width, mesh.texture_height);
+        }
+
+        return true;
+    }
+
+    void release(mesh_data& mesh)
+    {
+        // Assigning {} would keep the capacity around
+        std::vector<uint8_t>{}.swap(mesh.texture);
+        std::vector<std::vector<uint8_t>>{}.swap(mesh.texture_mips);
+    }
+}
@@ -0,0 +1,12 @@
+#pragma once
+
+#include "mesh_data.hpp"
+
+namespace texture_decoder
+{
+    // Fills texture, texture_mips, format and size from source_texture, false if it is corrupt
+    bool decode(mesh_data& mesh);
+
+    // Frees the decoded copy, source_texture is kept so the mesh can be decoded again
+    void release(mesh_data& mesh);
+}
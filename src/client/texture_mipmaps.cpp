@@ -0,0 +1,87 @@
+#include "std_include.hpp"
+
+#include "texture_mipmaps.hpp"
+#include "bc1_encoder.hpp"
+
+namespace texture_mipmaps
+{
+    namespace
+    {
+        constexpr int rgb_components = 3;
+    }
+
+    int get_level_count(int width, int height)
+    {
+        int levels = 1;
+
+        while (width > 1 || height > 1)
+        {
+            width = std::max(1, width / 2);
+            height = std::max(1, height / 2);
+            ++levels;
+        }
+
+        return levels;
+    }
+
+    std::vector<uint8_t> downsample_rgb(const uint8_t* pixels, const int width, const int height)
+    {
+        const auto target_width = std::max(1, width / 2);
+        const auto target_height = std::max(1, height / 2);
+
+        std::vector<uint8_t> output(static_cast<size_t>(target_width) * target_height * rgb_components);
+        auto* target = output.data();
+
+        for (int y = 0; y < target_height; ++y)
+        {
+            const auto* row0 = pixels + static_cast<size_t>(std::min(y * 2, height - 1)) * width * rgb_components;
+            const auto* row1 = pixels + static_cast<size_t>(std::min(y * 2 + 1, height - 1)) * width * rgb_components;
+
+            for (int x = 0; x < target_width; ++x)
+            {
+                const auto x0 = static_cast<size_t>(std::min(x * 2, width - 1)) * rgb_components;
+                const auto x1 = static_cast<size_t>(std::min(x * 2 + 1, width - 1)) * rgb_components;
+
+                for (int c = 0; c < rgb_components; ++c)
+                {
+                    *(target++) = static_cast<uint8_t>((row0[x0 + c] + row0[x1 + c] + row1[x0 + c] + row1[x1 + c] + 2) >> 2);
+                }
+            }
+        }
+
+        return output;
+    }
+
+    std::vector<std::vector<uint8_t>> generate(const std::vector<uint8_t>& texture, const texture_format format, int width, int height)
+    {
+        std::vector<std::vector<uint8_t>> levels{};
+
+        if (texture.empty() || width <= 0 || height <= 0)
+        {
+            return levels;
+        }
+
+        levels.reserve(static_cast<size_t>(get_level_count(width, height) - 1));
+
+        const auto* source = texture.data();
+
+        while (width > 1 || height > 1)
+        {
+            switch (format)
+            {
+            case texture_format::rgb:
+                levels.emplace_back(downsample_rgb(source, width, height));
+                break;
+            case texture_format::dxt1:
+                levels.emplace_back(bc1::downsample(source, width, height));
+                break;
+            }
+
+            source = levels.back().data();
+            width = std::max(1, width / 2);
+            height = std::max(1, height / 2);
+        }
+
+        return levels;
+    }
+}
@@ -0,0 +1,14 @@
+#pragma once
+
+#include "mesh_data.hpp"
+
+namespace texture_mipmaps
+{
+    int get_level_count(int width, int height);
+
+    // 2x2 box filter of 8 bit RGB pixels, odd edges are clamped to the last row/column
+    std::vector<uint8_t> downsample_rgb(const uint8_t* pixels, int width, int height);
+
+    // Builds levels 1..n of the chain, level 0 is the texture itself
+    std::vector<std::vector<uint8_t>> generate(const std::vector<uint8_t>& texture, texture_format format, int width, int height);
+}
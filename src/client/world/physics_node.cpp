@@ -68,16 +68,11 @@ physics_node::physics_node(world& game_world, const std::vector<mesh_data>& mesh
             );
         }
 
-        for (size_t i = 2; i < mesh_data.indices.size(); ++i)
+        for (size_t i = 2; i < mesh_data.indices.size(); i += 3)
         {
-            auto index1 = base_index + mesh_data.indices.at(i - 2);
-            auto index2 = base_index + mesh_data.indices.at(i - 1);
-            auto index3 = base_index + mesh_data.indices.at(i - 0);
-
-            if (i & 1)
-            {
-                std::swap(index1, index2);
-            }
+            const auto index1 = base_index + mesh_data.indices[i - 2];
+            const auto index2 = base_index + mesh_data.indices[i - 1];
+            const auto index3 = base_index + mesh_data.indices[i - 0];
 
             triangles.emplace_back(index1, index2, index3);
         }
@@ -6,6 +6,7 @@
 #include "../player_mesh.hpp"
 #include "../multiplayer.hpp"
 #include "../shader_context.hpp"
+#include "../pipeline.hpp"
 
 static void TraceImpl(const char* in_fmt, ...)
 {
@@ -150,6 +151,10 @@ class ObjectVsBroadPhaseLayerFilterImpl : public JPH::ObjectVsBroadPhaseLayerFil
 class world
 {
   public:
+    // Decoded textures waiting for their upload. No new decodes start above this, so tiles that fly by faster than
+    // they can be uploaded don't pile up in memory.
+    static constexpr size_t max_decoded_texture_bytes = 64 * 1024 * 1024;
+
     world(const std::string_view vertex_shader, const std::string_view fragment_shader)
         : temp_allocator_(10 * 1024 * 1024),
           job_system_(JPH::cMaxPhysicsJobs, JPH::cMaxPhysicsBarriers, static_cast<int>(std::thread::hardware_concurrency()) - 2),
@@ -199,6 +204,38 @@ class world
         return this->multiplayer_;
     }
 
+    // Meshes with decoded textures continue here on the bufferer thread, which owns the shared GL context
+    pipeline::queue_executor& get_upload_queue()
+    {
+        return this->upload_queue_;
+    }
+
+    // Resumed by the bufferer once the uploads of its last batch have finished on the GPU
+    pipeline::queue_executor& get_upload_fence()
+    {
+        return this->upload_fence_;
+    }
+
+    bool can_decode_textures() const
+    {
+        return this->decoded_texture_bytes_ < max_decoded_texture_bytes;
+    }
+
+    size_t get_decoded_texture_bytes() const
+    {
+        return this->decoded_texture_bytes_;
+    }
+
+    void add_decoded_texture_bytes(const size_t bytes)
+    {
+        this->decoded_texture_bytes_ += bytes;
+    }
+
+    void remove_decoded_texture_bytes(const size_t bytes)
+    {
+        this->decoded_texture_bytes_ -= bytes;
+    }
+
   private:
     physics_setup setup_{};
     JPH::TempAllocatorImpl temp_allocator_;
@@ -214,4 +251,8 @@ class world
     gl_bufferer bufferer_{};
     player_mesh player_mesh_;
     multiplayer multiplayer_;
+
+    pipeline::queue_executor upload_queue_{};
+    pipeline::queue_executor upload_fence_{};
+    std::atomic<size_t> decoded_texture_bytes_{0};
 };
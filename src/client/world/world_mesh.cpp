@@ -1,6 +1,7 @@
 #include "world_mesh.hpp"
 
 #include "../rocktree/rocktree.hpp"
+#include "../texture_decoder.hpp"
 
 world_mesh::world_mesh(node& node)
     : node_data(node)
@@ -13,14 +14,25 @@ world_mesh::world_mesh(node& node)
 
     if (node.sdata_.is_leaf && !node.meshes_.empty())
     {
+        // Built right after decoding on the same worker, another hop would not buy anything
+        const auto start = pipeline::clock::now();
         this->physics_node_.emplace(node.get_rocktree().with<world>(), node.meshes_, node.matrix_globe_from_mesh);
+        node.get_rocktree().get_pipeline_stats().record(pipeline::stage::physics, start);
     }
 }
 
+world_mesh::~world_mesh()
+{
+    this->release_textures();
+}
+
 void world_mesh::buffer_meshes()
 {
+    this->decode_textures();
+
     if (this->buffer_meshes_internal())
     {
+        this->release_textures();
         this->mark_as_buffered();
     }
 }
@@ -35,13 +47,26 @@ bool world_mesh::is_buffering() const
     return this->buffer_state_ == buffer_state::buffering;
 }
 
+// Textures stay compressed until they are needed, a worker decodes them and the bufferer uploads them.
+// While too many decoded textures wait for the bufferer, meshes stay unbuffered and are asked again next frame.
 bool world_mesh::mark_for_buffering()
 {
+    if (!this->get_node().get_rocktree().with<world>().can_decode_textures())
+    {
+        return false;
+    }
+
     auto expected = buffer_state::unbuffered;
-    return this->buffer_state_.compare_exchange_strong(expected, buffer_state::buffering);
+    if (!this->buffer_state_.compare_exchange_strong(expected, buffer_state::buffering))
+    {
+        return false;
+    }
+
+    this->run_buffering();
+    return true;
 }
 
-float world_mesh::draw(const shader_context& ctx, const uint64_t frame_index, const float current_time,
+float world_mesh::draw(const shader_context& ctx, const uint64_t frame_index, const float current_time, const float animation_time,
                        const std::array<float, 8>& child_draw_time, const std::array<int, 8>& octant_mask)
 {
     if (!this->draw_time_)
@@ -58,38 +83,23 @@ float world_mesh::draw(const shader_context& ctx, const uint64_t frame_index, co
     glUniform1iv(ctx.octant_mask_loc, 8, octant_mask.data());
     glUniform1fv(ctx.child_draw_times_loc, 8, child_draw_time.data());
 
-    for (auto& mesh : this->meshes_)
-    {
-        mesh.draw(ctx);
-    }
-
-    return own_draw_time;
-}
-
-void world_mesh::buffer_queue(std::queue<world_mesh*> meshes)
-{
-    std::queue<world_mesh*> meshes_to_notify{};
-
-    while (!meshes.empty())
+    // Octants that the vertex shader would fade out completely are not submitted at all
+    uint8_t visible_octants = 0;
+    for (size_t i = 0; i < octant_mask.size(); ++i)
     {
-        auto* mesh = meshes.front();
-        meshes.pop();
-
-        if (mesh && !mesh->get_node().is_being_deleted() && mesh->buffer_meshes_internal())
+        const auto hide_time = std::max(own_draw_time, child_draw_time[i]) + animation_time;
+        if (!octant_mask[i] || current_time < hide_time)
         {
-            meshes_to_notify.push(mesh);
+            visible_octants |= static_cast<uint8_t>(1 << i);
         }
     }
 
-    glFinish();
-
-    while (!meshes_to_notify.empty())
+    for (auto& mesh : this->meshes_)
     {
-        auto* node = meshes_to_notify.front();
-        meshes_to_notify.pop();
-
-        node->mark_as_buffered();
+        mesh.draw(ctx, visible_octants);
     }
+
+    return own_draw_time;
 }
 
 bool world_mesh::buffer_meshes_internal()
@@ -117,3 +127,102 @@ void world_mesh::mark_as_buffered()
 {
     this->buffer_state_ = buffer_state::buffered;
 }
+
+void world_mesh::decode_textures()
+{
+    size_t bytes = 0;
+
+    for (auto& m : this->get_node().meshes_)
+    {
+        texture_decoder::decode(m);
+
+        bytes += m.texture.size();
+        for (const auto& level : m.texture_mips)
+        {
+            bytes += level.size();
+        }
+    }
+
+    this->get_node().get_rocktree().with<world>().add_decoded_texture_bytes(bytes - this->decoded_texture_bytes_);
+    this->decoded_texture_bytes_ = bytes;
+
+    // The next start takes them from the decoded cache as they are
+    this->get_node().store_decoded_textures();
+}
+
+void world_mesh::release_textures()
+{
+    for (auto& m : this->get_node().meshes_)
+    {
+        texture_decoder::release(m);
+    }
+
+    this->get_node().get_rocktree().with<world>().remove_decoded_texture_bytes(this->decoded_texture_bytes_);
+    this->decoded_texture_bytes_ = 0;
+}
+
+// Texture decoding on a worker, then the upload on the bufferer thread. The node can't be deleted while the mesh is
+// buffering, so every way out has to leave that state, and as the very last step.
+pipeline::job world_mesh::run_buffering()
+{
+    auto& node = this->get_node();
+    auto& rocktree = node.get_rocktree();
+    auto& game_world = rocktree.with<world>();
+    auto& stats = rocktree.get_pipeline_stats();
+
+    pipeline::resume_on on_worker{
+        rocktree.get_task_manager(), {.priority = 0, .live_score = &node.get_fetch_priority(), .token = node.get_stop_token()}};
+
+    auto start = pipeline::clock::now();
+    const auto scheduled = co_await on_worker;
+
+    stats.record(pipeline::stage::queue, start);
+
+    // The node went out of use while the mesh was queued
+    if (!scheduled || node.is_being_deleted())
+    {
+        this->buffer_state_ = buffer_state::unbuffered;
+        co_return;
+    }
+
+    // Nothing in here is expected to throw, but an exception would end the process from inside the coroutine
+    try
+    {
+        start = pipeline::clock::now();
+        this->decode_textures();
+        stats.record(pipeline::stage::texture, start);
+
+        start = pipeline::clock::now();
+        co_await game_world.get_upload_queue().schedule();
+
+        if (node.is_being_deleted())
+        {
+            this->release_textures();
+            this->buffer_state_ = buffer_state::unbuffered;
+            co_return;
+        }
+
+        this->buffer_meshes_internal();
+
+        // The bufferer waits for the whole batch at once
+        co_await game_world.get_upload_fence().schedule();
+
+        this->release_textures();
+        stats.record(pipeline::stage::upload, start);
+
+        this->mark_as_buffered();
+    }
+    catch (const std::exception& e)
+    {
+#ifdef NDEBUG
+        (void)e;
+#else
+        puts(e.what());
+#endif
+
+        // Retrying would most likely fail the same way, the node is dropped and fetched again once it is needed
+        this->release_textures();
+        node.mark_for_deletion();
+        this->buffer_state_ = buffer_state::failed;
+    }
+}
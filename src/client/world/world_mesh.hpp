@@ -1,21 +1,21 @@
 #pragma once
 
 #include "physics_node.hpp"
+#include "../mesh.hpp"
 
 class world_mesh : public node_data
 {
   public:
     world_mesh(node& node);
+    ~world_mesh() override;
 
     void buffer_meshes();
     bool is_buffered() const;
     bool is_buffering() const;
     bool mark_for_buffering();
 
-    float draw(const shader_context& ctx, uint64_t frame_index, float current_time, const std::array<float, 8>& child_draw_time,
-               const std::array<int, 8>& octant_mask);
-
-    static void buffer_queue(std::queue<world_mesh*> meshes);
+    float draw(const shader_context& ctx, uint64_t frame_index, float current_time, float animation_time,
+               const std::array<float, 8>& child_draw_time, const std::array<int, 8>& octant_mask);
 
   private:
     enum class buffer_state
@@ -23,6 +23,7 @@ class world_mesh : public node_data
         unbuffered,
         buffering,
         buffered,
+        failed, // never retried, the node gets deleted
     };
 
     uint64_t last_frame_index_{};
@@ -30,10 +31,15 @@ class world_mesh : public node_data
     std::optional<float> draw_time_{};
     std::atomic<buffer_state> buffer_state_{buffer_state::unbuffered};
     std::optional<physics_node> physics_node_{};
+    size_t decoded_texture_bytes_{};
 
     bool buffer_meshes_internal();
     void mark_as_buffered();
 
+    void decode_textures();
+    void release_textures();
+    pipeline::job run_buffering();
+
     bool can_be_deleted() const override
     {
         return this->buffer_state_ != buffer_state::buffering;
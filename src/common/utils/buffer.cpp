@@ -0,0 +1,236 @@
+#include "buffer.hpp"
+
+#include <array>
+#include <cassert>
+#include <algorithm>
+#include <mutex>
+#include <vector>
+#include <cstring>
+#include <stdexcept>
+
+namespace utils
+{
+    namespace
+    {
+        // Power of two size classes from 4 KB to 16 MB, larger blocks are not pooled
+        constexpr size_t min_class_shift = 12;
+        constexpr size_t max_class_shift = 24;
+        constexpr size_t class_count = max_class_shift - min_class_shift + 1;
+        constexpr size_t max_pooled_bytes = 64ull << 20;
+
+        size_t get_size_class(const size_t size)
+        {
+            size_t shift = min_class_shift;
+            while ((static_cast<size_t>(1) << shift) < size)
+            {
+                ++shift;
+            }
+
+            return shift - min_class_shift;
+        }
+
+        size_t get_class_capacity(const size_t size_class)
+        {
+            return static_cast<size_t>(1) << (size_class + min_class_shift);
+        }
+
+        class block_pool
+        {
+          public:
+            std::unique_ptr<uint8_t[]> acquire(size_t& capacity)
+            {
+                const auto size_class = get_size_class(capacity);
+                if (size_class >= class_count)
+                {
+                    return std::make_unique_for_overwrite<uint8_t[]>(capacity);
+                }
+
+                capacity = get_class_capacity(size_class);
+
+                {
+                    std::lock_guard _{this->mutex_};
+
+                    auto& blocks = this->free_blocks_[size_class];
+                    if (!blocks.empty())
+                    {
+                        auto block = std::move(blocks.back());
+                        blocks.pop_back();
+                        this->pooled_bytes_ -= capacity;
+                        return block;
+                    }
+                }
+
+                return std::make_unique_for_overwrite<uint8_t[]>(capacity);
+            }
+
+            void release(std::unique_ptr<uint8_t[]> block, const size_t capacity)
+            {
+                const auto size_class = get_size_class(capacity);
+                if (!block || size_class >= class_count || get_class_capacity(size_class) != capacity)
+                {
+                    return;
+                }
+
+                std::lock_guard _{this->mutex_};
+
+                if (this->pooled_bytes_ + capacity <= max_pooled_bytes)
+                {
+                    this->pooled_bytes_ += capacity;
+                    this->free_blocks_[size_class].emplace_back(std::move(block));
+                }
+            }
+
+          private:
+            std::mutex mutex_{};
+            std::array<std::vector<std::unique_ptr<uint8_t[]>>, class_count> free_blocks_{};
+            size_t pooled_bytes_{0};
+        };
+
+        block_pool& get_pool()
+        {
+            // Intentionally leaked, buffers may outlive static destruction
+            static auto* pool = new block_pool();
+            return *pool;
+        }
+
+        struct pooled_block
+        {
+            std::unique_ptr<uint8_t[]> memory{};
+            size_t capacity{};
+
+            ~pooled_block()
+            {
+                get_pool().release(std::move(this->memory), this->capacity);
+            }
+        };
+    }
+
+    shared_buffer::shared_buffer(std::string data)
+    {
+        auto owner = std::make_shared<const std::string>(std::move(data));
+        this->data_ = reinterpret_cast<const uint8_t*>(owner->data());
+        this->size_ = owner->size();
+        this->owner_ = std::move(owner);
+    }
+
+    shared_buffer::shared_buffer(std::shared_ptr<const void> owner, const uint8_t* data, const size_t size)
+        : owner_(std::move(owner)),
+          data_(data),
+          size_(size)
+    {
+    }
+
+    shared_buffer shared_buffer::slice(const size_t offset, const size_t size) const
+    {
+        if (offset > this->size_ || size > this->size_ - offset)
+        {
+            throw std::out_of_range("Buffer slice out of range");
+        }
+
+        return {this->owner_, this->data_ + offset, size};
+    }
+
+    buffer_builder::buffer_builder(const size_t capacity)
+    {
+        this->reserve(capacity);
+    }
+
+    buffer_builder::~buffer_builder()
+    {
+        this->release();
+    }
+
+    buffer_builder::buffer_builder(buffer_builder&& obj) noexcept
+    {
+        this->operator=(std::move(obj));
+    }
+
+    buffer_builder& buffer_builder::operator=(buffer_builder&& obj) noexcept
+    {
+        if (this != &obj)
+        {
+            this->release();
+
+            this->memory_ = std::move(obj.memory_);
+            this->capacity_ = obj.capacity_;
+            this->size_ = obj.size_;
+
+            obj.capacity_ = 0;
+            obj.size_ = 0;
+        }
+
+        return *this;
+    }
+
+    void buffer_builder::reserve(const size_t capacity)
+    {
+        if (capacity <= this->capacity_)
+        {
+            return;
+        }
+
+        auto new_capacity = capacity;
+        auto memory = get_pool().acquire(new_capacity);
+
+        if (this->size_ > 0)
+        {
+            memcpy(memory.get(), this->memory_.get(), this->size_);
+        }
+
+        // Only the old block goes back to the pool, the data it held was just copied over
+        get_pool().release(std::move(this->memory_), this->capacity_);
+
+        this->memory_ = std::move(memory);
+        this->capacity_ = new_capacity;
+    }
+
+    void buffer_builder::append(const void* data, const size_t size)
+    {
+        if (size > 0)
+        {
+            memcpy(this->extend(size), data, size);
+        }
+    }
+
+    uint8_t* buffer_builder::extend(const size_t size)
+    {
+        if (this->size_ + size > this->capacity_)
+        {
+            [[maybe_unused]] const auto previous_size = this->size_;
+            this->reserve(std::max(this->size_ + size, this->capacity_ * 2));
+
+            // Growing keeps everything appended so far
+            assert(this->size_ == previous_size && this->size_ + size <= this->capacity_);
+        }
+
+        auto* tail = this->memory_.get() + this->size_;
+        this->size_ += size;
+        return tail;
+    }
+
+    shared_buffer buffer_builder::finish()
+    {
+        const auto size = this->size_;
+        if (!this->memory_)
+        {
+            return {};
+        }
+
+        auto block = std::make_shared<pooled_block>();
+        block->memory = std::move(this->memory_);
+        block->capacity = this->capacity_;
+
+        this->capacity_ = 0;
+        this->size_ = 0;
+
+        const auto* data = block->memory.get();
+        return {std::move(block), data, size};
+    }
+
+    void buffer_builder::release()
+    {
+        get_pool().release(std::move(this->memory_), this->capacity_);
+        this->capacity_ = 0;
+        this->size_ = 0;
+    }
+}
@@ -0,0 +1,93 @@
+#pragma once
+
+#include <span>
+#include <memory>
+#include <string>
+#include <cstdint>
+#include <string_view>
+
+namespace utils
+{
+    // Immutable, ref-counted bytes. The storage is a pooled block, an adopted string or a file mapping,
+    // copies and slices only share it.
+    class shared_buffer
+    {
+      public:
+        shared_buffer() = default;
+        explicit shared_buffer(std::string data);
+        shared_buffer(std::shared_ptr<const void> owner, const uint8_t* data, size_t size);
+
+        const uint8_t* data() const
+        {
+            return this->data_;
+        }
+
+        size_t size() const
+        {
+            return this->size_;
+        }
+
+        bool empty() const
+        {
+            return this->size_ == 0;
+        }
+
+        std::span<const uint8_t> span() const
+        {
+            return {this->data_, this->size_};
+        }
+
+        std::string_view view() const
+        {
+            return {reinterpret_cast<const char*>(this->data_), this->size_};
+        }
+
+        shared_buffer slice(size_t offset, size_t size) const;
+
+      private:
+        std::shared_ptr<const void> owner_{};
+        const uint8_t* data_{};
+        size_t size_{};
+    };
+
+    // Fills a block taken from a process wide pool, then hands it out as a shared_buffer without copying.
+    // The block goes back to the pool once the last shared_buffer referencing it is gone.
+    class buffer_builder
+    {
+      public:
+        buffer_builder() = default;
+        explicit buffer_builder(size_t capacity);
+        ~buffer_builder();
+
+        buffer_builder(const buffer_builder&) = delete;
+        buffer_builder& operator=(const buffer_builder&) = delete;
+
+        buffer_builder(buffer_builder&& obj) noexcept;
+        buffer_builder& operator=(buffer_builder&& obj) noexcept;
+
+        void reserve(size_t capacity);
+        void append(const void* data, size_t size);
+
+        // Grows the buffer and returns the uninitialized tail to write into
+        uint8_t* extend(size_t size);
+
+        size_t size() const
+        {
+            return this->size_;
+        }
+
+        size_t capacity() const
+        {
+            return this->capacity_;
+        }
+
+        shared_buffer finish();
+
+      private:
+        std::unique_ptr<uint8_t[]> memory_{};
+        size_t capacity_{};
+        size_t size_{};
+
+        void release();
+    };
+}
@@ -1,5 +1,6 @@
 #pragma once
 
+#include <span>
 #include <string>
 #include <vector>
 #include <stdexcept>
@@ -29,6 +30,13 @@ namespace utils
         {
         }
 
+        template <typename T>
+        buffer_deserializer(const std::span<const T>& buffer)
+            : buffer_(reinterpret_cast<const std::byte*>(buffer.data()), buffer.size_bytes())
+        {
+            static_assert(std::is_trivially_copyable_v<T>, "Type must be trivially copyable");
+        }
+
         void read(void* data, const size_t length)
         {
             if (this->offset_ + length > this->buffer_.size())
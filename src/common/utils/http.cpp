@@ -1,6 +1,10 @@
 #include "http.hpp"
 #include <curl/curl.h>
 
+#include <array>
+#include <mutex>
+#include <algorithm>
+
 #include "thread.hpp"
 #include "finally.hpp"
 
@@ -14,24 +18,145 @@ namespace utils::http
 {
     namespace
     {
-        void setup_curl()
+        // Process wide curl state. DNS results and TLS sessions are shared by all handles through one CURLSH.
+        // Connections stay per multi handle, curl does not support sharing them between concurrently running threads.
+        class curl_state
         {
-            static struct x
+          public:
+            curl_state()
             {
-                x()
+                curl_global_init(CURL_GLOBAL_DEFAULT);
+
+                const auto* info = curl_version_info(CURLVERSION_NOW);
+                this->http2_ = info && (info->features & CURL_VERSION_HTTP2);
+
+                this->share_ = curl_share_init();
+                if (this->share_)
                 {
-                    curl_global_init(CURL_GLOBAL_DEFAULT);
+                    curl_share_setopt(this->share_, CURLSHOPT_LOCKFUNC, lock_data);
+                    curl_share_setopt(this->share_, CURLSHOPT_UNLOCKFUNC, unlock_data);
+                    curl_share_setopt(this->share_, CURLSHOPT_USERDATA, this);
+                    curl_share_setopt(this->share_, CURLSHOPT_SHARE, CURL_LOCK_DATA_DNS);
+                    curl_share_setopt(this->share_, CURLSHOPT_SHARE, CURL_LOCK_DATA_SSL_SESSION);
                 }
+            }
 
-                ~x()
+            ~curl_state()
+            {
+                if (this->share_)
                 {
-                    curl_global_cleanup();
+                    curl_share_cleanup(this->share_);
                 }
-            } _;
 
-            (void)_;
+                curl_global_cleanup();
+            }
+
+            curl_state(const curl_state&) = delete;
+            curl_state& operator=(const curl_state&) = delete;
+
+            curl_state(curl_state&&) = delete;
+            curl_state& operator=(curl_state&&) = delete;
+
+            CURLSH* get_share() const
+            {
+                return this->share_;
+            }
+
+            bool supports_http2() const
+            {
+                return this->http2_;
+            }
+
+          private:
+            CURLSH* share_{};
+            bool http2_{false};
+            std::array<std::mutex, CURL_LOCK_DATA_LAST> mutexes_{};
+
+            static void lock_data(CURL*, const curl_lock_data data, curl_lock_access, void* userptr)
+            {
+                static_cast<curl_state*>(userptr)->mutexes_.at(data).lock();
+            }
+
+            static void unlock_data(CURL*, const curl_lock_data data, void* userptr)
+            {
+                static_cast<curl_state*>(userptr)->mutexes_.at(data).unlock();
+            }
+        };
+
+        const curl_state& setup_curl()
+        {
+            static curl_state state{};
+            return state;
         }
 
+        void apply_connection_options(CURL* curl)
+        {
+            const auto& state = setup_curl();
+
+            curl_easy_setopt(curl, CURLOPT_SHARE, state.get_share());
+            curl_easy_setopt(curl, CURLOPT_TCP_KEEPALIVE, 1L);
+            curl_easy_setopt(curl, CURLOPT_DNS_CACHE_TIMEOUT, 300L);
+
+            // Negotiated via ALPN, servers without HTTP/2 and plain http:// URLs stay on HTTP/1.1
+            if (state.supports_http2())
+            {
+                curl_easy_setopt(curl, CURLOPT_HTTP_VERSION, static_cast<long>(CURL_HTTP_VERSION_2TLS));
+                curl_easy_setopt(curl, CURLOPT_PIPEWAIT, 1L);
+            }
+        }
+
+        // Finished easy handles are reset and reused, which keeps their connection and DNS caches alive
+        class easy_handle_pool
+        {
+          public:
+            easy_handle_pool(const size_t max_idle)
+                : max_idle_(max_idle)
+            {
+            }
+
+            ~easy_handle_pool()
+            {
+                for (auto* handle : this->idle_)
+                {
+                    curl_easy_cleanup(handle);
+                }
+            }
+
+            easy_handle_pool(const easy_handle_pool&) = delete;
+            easy_handle_pool& operator=(const easy_handle_pool&) = delete;
+
+            easy_handle_pool(easy_handle_pool&&) = delete;
+            easy_handle_pool& operator=(easy_handle_pool&&) = delete;
+
+            CURL* acquire()
+            {
+                if (this->idle_.empty())
+                {
+                    return curl_easy_init();
+                }
+
+                auto* handle = this->idle_.back();
+                this->idle_.pop_back();
+                return handle;
+            }
+
+            void release(CURL* handle)
+            {
+                if (this->idle_.size() >= this->max_idle_)
+                {
+                    curl_easy_cleanup(handle);
+                    return;
+                }
+
+                curl_easy_reset(handle);
+                this->idle_.push_back(handle);
+            }
+
+          private:
+            size_t max_idle_{};
+            std::vector<CURL*> idle_{};
+        };
+
         struct progress_helper
         {
             const std::function<void(size_t)>* callback{};
@@ -68,6 +193,35 @@ namespace utils::http
             return total_size;
         }
 
+        // Receives a download straight into a pooled block that is later handed to the waiters as is
+        struct response_sink
+        {
+            CURL* request{};
+            buffer_builder builder{};
+            bool reserved{false};
+        };
+
+        size_t write_response_callback(void* contents, const size_t size, const size_t nmemb, void* userp)
+        {
+            auto* sink = static_cast<response_sink*>(userp);
+
+            if (!sink->reserved)
+            {
+                sink->reserved = true;
+
+                curl_off_t content_length = -1;
+                if (curl_easy_getinfo(sink->request, CURLINFO_CONTENT_LENGTH_DOWNLOAD_T, &content_length) == CURLE_OK &&
+                    content_length > 0)
+                {
+                    sink->builder.reserve(static_cast<size_t>(content_length));
+                }
+            }
+
+            const auto total_size = size * nmemb;
+            sink->builder.append(contents, total_size);
+            return total_size;
+        }
+
         std::optional<std::string> perform_request(const std::string& url, const std::string* post_body, const headers& headers,
                                                    const std::function<void(size_t)>& callback, const uint32_t retries)
         {
@@ -107,6 +261,7 @@ namespace utils::http
             curl_easy_setopt(curl, CURLOPT_FAILONERROR, 1L);
             curl_easy_setopt(curl, CURLOPT_SSL_VERIFYPEER, 0L);
             curl_easy_setopt(curl, CURLOPT_SSL_VERIFYHOST, 0L);
+            apply_connection_options(curl);
 
             if (post_body)
             {
@@ -152,15 +307,21 @@ namespace utils::http
           public:
             curl_easy_request() = default;
 
-            curl_easy_request(const std::string& url, stoppable_result_callback callback, CURLM* multi_request = nullptr)
-                : result_(std::make_unique<std::string>()),
-                  result_function_(std::move(callback)),
+            curl_easy_request(const std::string& url, std::shared_ptr<transfer> waiters, easy_handle_pool& pool,
+                              CURLM* multi_request = nullptr)
+                : url_(url),
+                  sink_(std::make_unique<response_sink>()),
+                  waiters_(std::move(waiters)),
+                  pool_(&pool),
                   multi_request_(multi_request),
-                  request_(curl_easy_init())
+                  request_(pool.acquire())
             {
+                this->sink_->request = this->request_;
+
+                apply_connection_options(this->request_);
                 curl_easy_setopt(this->request_, CURLOPT_URL, url.data());
-                curl_easy_setopt(this->request_, CURLOPT_WRITEFUNCTION, write_callback);
-                curl_easy_setopt(this->request_, CURLOPT_WRITEDATA, result_.get());
+                curl_easy_setopt(this->request_, CURLOPT_WRITEFUNCTION, write_response_callback);
+                curl_easy_setopt(this->request_, CURLOPT_WRITEDATA, this->sink_.get());
                 curl_easy_setopt(this->request_, CURLOPT_NOPROGRESS, 1L);
                 curl_easy_setopt(this->request_, CURLOPT_FOLLOWLOCATION, 1L);
                 curl_easy_setopt(this->request_, CURLOPT_USERAGENT, "bird-client/1.0");
@@ -187,8 +348,10 @@ namespace utils::http
                 {
                     this->clear();
 
-                    this->result_ = std::move(obj.result_);
-                    this->result_function_ = std::move(obj.result_function_);
+                    this->url_ = std::move(obj.url_);
+                    this->sink_ = std::move(obj.sink_);
+                    this->waiters_ = std::move(obj.waiters_);
+                    this->pool_ = obj.pool_;
 
                     this->multi_request_ = std::move(obj.multi_request_);
                     this->request_ = std::move(obj.request_);
@@ -212,25 +375,46 @@ namespace utils::http
 
             void notify(const bool success)
             {
-                result res{};
-                if (success && this->result_ && this->has_success_code())
+                response res{};
+                res.status = this->get_status_code();
+
+                if (success && this->sink_ && res.status >= 200)
                 {
-                    res = std::move(*this->result_);
-                    this->result_.reset();
+                    res.data = this->sink_->builder.finish();
+                    this->sink_.reset();
                 }
 
-                this->result_function_(std::move(res));
+                this->waiters_->complete(std::move(res));
+            }
+
+            bool try_cancel() const
+            {
+                return this->waiters_->try_cancel();
+            }
+
+            long get_status_code() const
+            {
+                long http_code = 0;
+                curl_easy_getinfo(this->request_, CURLINFO_RESPONSE_CODE, &http_code);
+                return http_code;
+            }
+
+            const std::string& get_url() const
+            {
+                return this->url_;
             }
 
-            bool is_cancelled() const
+            const transfer* get_transfer() const
             {
-                return this->result_function_.is_stopped();
+                return this->waiters_.get();
             }
 
           private:
-            std::unique_ptr<std::string> result_{};
-            stoppable_result_callback result_function_;
+            std::string url_{};
+            std::unique_ptr<response_sink> sink_{};
+            std::shared_ptr<transfer> waiters_{};
 
+            easy_handle_pool* pool_{};
             CURLM* multi_request_{};
             CURL* request_{};
 
@@ -246,33 +430,389 @@ namespace utils::http
                     curl_multi_remove_handle(this->multi_request_, this->request_);
                 }
 
-                curl_easy_cleanup(this->request_);
+                this->pool_->release(this->request_);
+            }
+
+        };
+    }
+
+    transfer::transfer(stoppable_result_callback callback)
+    {
+        this->waiters_.emplace_back(std::move(callback));
+    }
+
+    bool transfer::join(stoppable_result_callback& callback)
+    {
+        std::lock_guard _{this->mutex_};
+        if (this->completed_)
+        {
+            return false;
+        }
+
+        this->waiters_.emplace_back(std::move(callback));
+        return true;
+    }
+
+    void transfer::complete(response r)
+    {
+        std::vector<stoppable_result_callback> waiters{};
+
+        {
+            std::lock_guard _{this->mutex_};
+            this->completed_ = true;
+            waiters = std::move(this->waiters_);
+            this->waiters_.clear();
+        }
+
+        for (size_t i = 0; i < waiters.size(); ++i)
+        {
+            if (i + 1 == waiters.size())
+            {
+                waiters[i](std::move(r));
             }
+            else
+            {
+                waiters[i](r);
+            }
+        }
+    }
 
-            bool has_success_code() const
+    bool transfer::try_cancel()
+    {
+        std::lock_guard _{this->mutex_};
+
+        if (!this->completed_)
+        {
+            for (const auto& waiter : this->waiters_)
             {
-                long http_code = 0;
-                curl_easy_getinfo(this->request_, CURLINFO_RESPONSE_CODE, &http_code);
-                return http_code >= 200;
+                if (!waiter.is_stopped())
+                {
+                    return false;
+                }
             }
-        };
+        }
+
+        this->completed_ = true;
+        return true;
+    }
+
+    void query_queue::push(query q, const request_priority priority)
+    {
+        const auto index = this->heap_.size();
+        this->positions_[q.url] = index;
+        this->heap_.emplace_back(entry{std::move(q), priority, this->next_sequence_++});
+        this->sift_up(index);
+    }
+
+    query query_queue::pop()
+    {
+        this->swap_entries(0, this->heap_.size() - 1);
+
+        auto result = std::move(this->heap_.back().q);
+        this->heap_.pop_back();
+
+        const auto position = this->positions_.find(result.url);
+        if (position != this->positions_.end() && position->second == this->heap_.size())
+        {
+            this->positions_.erase(position);
+        }
+
+        if (!this->heap_.empty())
+        {
+            this->sift_down(0);
+        }
+
+        return result;
+    }
+
+    bool query_queue::update_priority(const url_string& url, const request_priority priority)
+    {
+        const auto position = this->positions_.find(url);
+        if (position == this->positions_.end())
+        {
+            return false;
+        }
+
+        const auto index = position->second;
+        auto& e = this->heap_.at(index);
+        const auto old_priority = e.priority;
+        e.priority = priority;
+
+        if (priority > old_priority)
+        {
+            this->sift_up(index);
+        }
+        else
+        {
+            this->sift_down(index);
+        }
+
+        return true;
+    }
+
+    bool query_queue::raise_priority(const url_string& url, const request_priority priority)
+    {
+        const auto position = this->positions_.find(url);
+        if (position == this->positions_.end() || this->heap_.at(position->second).priority >= priority)
+        {
+            return false;
+        }
+
+        return this->update_priority(url, priority);
+    }
+
+    std::shared_ptr<transfer> query_queue::find_transfer(const url_string& url)
+    {
+        const auto entry = this->transfers_.find(url);
+        if (entry == this->transfers_.end())
+        {
+            return {};
+        }
+
+        auto t = entry->second.lock();
+        if (!t)
+        {
+            this->transfers_.erase(entry);
+        }
+
+        return t;
+    }
+
+    void query_queue::add_transfer(const url_string& url, const std::shared_ptr<transfer>& t)
+    {
+        this->transfers_[url] = t;
+    }
+
+    void query_queue::remove_transfer(const url_string& url, const transfer* t)
+    {
+        const auto entry = this->transfers_.find(url);
+        if (entry == this->transfers_.end())
+        {
+            return;
+        }
+
+        // A newer transfer for the same URL might have replaced it already
+        const auto current = entry->second.lock();
+        if (!current || current.get() == t)
+        {
+            this->transfers_.erase(entry);
+        }
+    }
+
+    bool query_queue::empty() const
+    {
+        return this->heap_.empty();
+    }
+
+    size_t query_queue::size() const
+    {
+        return this->heap_.size();
+    }
+
+    bool query_queue::is_before(const size_t a, const size_t b) const
+    {
+        const auto& entry_a = this->heap_[a];
+        const auto& entry_b = this->heap_[b];
+
+        if (entry_a.priority != entry_b.priority)
+        {
+            return entry_a.priority > entry_b.priority;
+        }
+
+        return entry_a.sequence < entry_b.sequence;
+    }
+
+    void query_queue::swap_entries(const size_t a, const size_t b)
+    {
+        if (a == b)
+        {
+            return;
+        }
+
+        const auto position_a = this->positions_.find(this->heap_[a].q.url);
+        const auto position_b = this->positions_.find(this->heap_[b].q.url);
+
+        // Duplicate URLs share one index slot, only move it along with the entry it points to
+        const auto is_indexed_a = position_a != this->positions_.end() && position_a->second == a;
+        const auto is_indexed_b = position_b != this->positions_.end() && position_b->second == b;
+
+        std::swap(this->heap_[a], this->heap_[b]);
+
+        if (is_indexed_a)
+        {
+            position_a->second = b;
+        }
+
+        if (is_indexed_b)
+        {
+            position_b->second = a;
+        }
+    }
+
+    void query_queue::sift_up(size_t index)
+    {
+        while (index > 0)
+        {
+            const auto parent = (index - 1) / 2;
+            if (!this->is_before(index, parent))
+            {
+                break;
+            }
+
+            this->swap_entries(index, parent);
+            index = parent;
+        }
+    }
+
+    void query_queue::sift_down(size_t index)
+    {
+        while (true)
+        {
+            const auto left = index * 2 + 1;
+            const auto right = left + 1;
+            auto best = index;
+
+            if (left < this->heap_.size() && this->is_before(left, best))
+            {
+                best = left;
+            }
+
+            if (right < this->heap_.size() && this->is_before(right, best))
+            {
+                best = right;
+            }
+
+            if (best == index)
+            {
+                break;
+            }
+
+            this->swap_entries(index, best);
+            index = best;
+        }
+    }
+
+    concurrency_controller::concurrency_controller(const size_t initial_limit)
+        : limit_(std::clamp(initial_limit, min_limit, max_limit))
+    {
+        this->state_.limit = this->limit_;
+    }
+
+    void concurrency_controller::record_transfer(const std::chrono::microseconds latency, const uint64_t bytes, const bool failed)
+    {
+        std::lock_guard _{this->mutex_};
+
+        ++this->transfers_;
+        this->bytes_ += bytes;
+        this->latency_sum_ += latency;
+
+        if (failed)
+        {
+            ++this->failures_;
+        }
+
+        const auto now = clock::now();
+        if (now - this->window_start_ >= window)
+        {
+            this->evaluate(now);
+        }
+    }
+
+    void concurrency_controller::record_saturation()
+    {
+        std::lock_guard _{this->mutex_};
+        this->saturated_ = true;
+    }
+
+    size_t concurrency_controller::get_limit() const
+    {
+        return this->limit_;
+    }
+
+    concurrency_controller::state concurrency_controller::get_state() const
+    {
+        std::lock_guard _{this->mutex_};
+        return this->state_;
+    }
+
+    void concurrency_controller::evaluate(const clock::time_point now)
+    {
+        const auto elapsed = std::chrono::duration<double>(now - this->window_start_).count();
+        const auto latency = this->latency_sum_ / std::max(this->transfers_, static_cast<size_t>(1));
+
+        auto& s = this->state_;
+        s.throughput = static_cast<double>(this->bytes_) / elapsed;
+        s.latency = std::chrono::duration_cast<std::chrono::milliseconds>(latency);
+        s.error_rate = static_cast<double>(this->failures_) / static_cast<double>(std::max(this->transfers_, static_cast<size_t>(1)));
+
+        // The baseline follows the lowest latency seen, but slowly forgets it in case the route changed
+        if (this->baseline_latency_.count() == 0 || latency < this->baseline_latency_)
+        {
+            this->baseline_latency_ = latency;
+        }
+        else
+        {
+            this->baseline_latency_ += (latency - this->baseline_latency_) / 50;
+        }
+
+        const auto limit = this->limit_.load();
+        auto new_limit = limit;
+        s.last_decision = decision::hold;
+
+        if (this->transfers_ >= min_samples)
+        {
+            const auto is_congested = s.error_rate > 0.05 || latency > this->baseline_latency_ * 4;
+            const auto throughput_dropped = this->was_saturated_ && this->saturated_ && s.throughput < this->previous_throughput_ * 0.8;
+
+            if (is_congested || throughput_dropped)
+            {
+                new_limit = static_cast<size_t>(static_cast<double>(limit) * decrease_factor);
+                s.last_decision = decision::decrease;
+            }
+            else if (this->saturated_)
+            {
+                new_limit = limit + increase_step;
+                s.last_decision = decision::increase;
+            }
+        }
+
+        new_limit = std::clamp(new_limit, min_limit, max_limit);
+        this->limit_ = new_limit;
+        s.limit = new_limit;
+
+        this->previous_throughput_ = s.throughput;
+        this->was_saturated_ = this->saturated_;
+
+        this->window_start_ = now;
+        this->transfers_ = 0;
+        this->failures_ = 0;
+        this->bytes_ = 0;
+        this->latency_sum_ = {};
+        this->saturated_ = false;
     }
 
     class worker_thread::worker
     {
       public:
-        worker(const size_t max_requests)
-            : max_requests_(max_requests),
-              request_(curl_multi_init())
+        worker(concurrency_controller& controller, const size_t worker_count)
+            : controller_(&controller),
+              worker_count_(std::max(worker_count, static_cast<size_t>(1))),
+              pool_(concurrency_controller::max_limit)
         {
             setup_curl();
+
+            this->request_ = curl_multi_init();
+            if (this->request_)
+            {
+                curl_multi_setopt(this->request_, CURLMOPT_PIPELINING, CURLPIPE_MULTIPLEX);
+            }
         }
 
         worker(const worker&) = delete;
         worker& operator=(const worker&) = delete;
 
-        worker(worker&&) noexcept = default;
-        worker& operator=(worker&&) noexcept = default;
+        worker(worker&&) = delete;
+        worker& operator=(worker&&) = delete;
 
         ~worker()
         {
@@ -293,7 +833,7 @@ namespace utils::http
         void wakeup() const
         {
             std::atomic_thread_fence(std::memory_order_acquire);
-            if (this->request_ && this->active_requests_.size() < this->max_requests_)
+            if (this->request_ && this->active_requests_.size() < this->get_max_requests())
             {
                 curl_multi_wakeup(this->request_);
             }
@@ -306,7 +846,7 @@ namespace utils::http
 
             while (std::chrono::steady_clock::now() < end)
             {
-                this->clear_cancelled_requests();
+                this->clear_cancelled_requests(queue);
                 this->add_new_requests(queue);
 
                 if (this->active_requests_.empty())
@@ -328,40 +868,47 @@ namespace utils::http
                     (void)this->poll_current_requests(timeout_duration);
                 }
 
-                this->dispatch_results();
+                this->dispatch_results(queue);
             }
 
             return !this->active_requests_.empty();
         }
 
       private:
-        size_t max_requests_{};
+        concurrency_controller* controller_{};
+        size_t worker_count_{};
+        easy_handle_pool pool_;
         CURLM* request_{};
         std::unordered_map<void*, curl_easy_request> active_requests_{};
 
         void add_new_requests(concurrency::container<query_queue>& queue)
         {
-            if (this->active_requests_.size() >= this->max_requests_)
+            const auto max_requests = this->get_max_requests();
+            if (this->active_requests_.size() >= max_requests)
             {
+                if (!queue.access<bool>([](const query_queue& q) { return q.empty(); }))
+                {
+                    this->controller_->record_saturation();
+                }
+
                 return;
             }
 
-            std::vector<stoppable_result_callback> deleted_callbacks{};
-            queue.access([this, &deleted_callbacks](query_queue& queue) {
-                while (!queue.empty() && this->active_requests_.size() < this->max_requests_)
+            std::vector<std::shared_ptr<transfer>> cancelled_transfers{};
+            queue.access([this, max_requests, &cancelled_transfers](query_queue& queue) {
+                while (!queue.empty() && this->active_requests_.size() < max_requests)
                 {
-                    auto& query = queue.front();
-                    if (!query.callback.is_stopped())
+                    auto query = queue.pop();
+                    if (!query.waiters->try_cancel())
                     {
-                        curl_easy_request request(query.url, std::move(query.callback), this->request_);
+                        curl_easy_request request(query.url, std::move(query.waiters), this->pool_, this->request_);
                         this->active_requests_[request.get_request()] = std::move(request);
                     }
                     else
                     {
-                        deleted_callbacks.emplace_back(std::move(query.callback));
+                        queue.remove_transfer(query.url, query.waiters.get());
+                        cancelled_transfers.emplace_back(std::move(query.waiters));
                     }
-
-                    queue.pop_front();
                 }
             });
         }
@@ -383,12 +930,15 @@ namespace utils::http
             return curl_multi_poll(this->request_, nullptr, 0, static_cast<int>(timeout.count()), nullptr) == 0;
         }
 
-        void clear_cancelled_requests()
+        void clear_cancelled_requests(concurrency::container<query_queue>& queue)
         {
+            std::vector<curl_easy_request> cancelled_requests{};
+
             for (auto i = this->active_requests_.begin(); i != this->active_requests_.end();)
             {
-                if (i->second.is_cancelled())
+                if (i->second.try_cancel())
                 {
+                    cancelled_requests.emplace_back(std::move(i->second));
                     i = this->active_requests_.erase(i);
                 }
                 else
@@ -396,10 +946,14 @@ namespace utils::http
                     ++i;
                 }
             }
+
+            release_transfers(queue, cancelled_requests);
         }
 
-        void dispatch_results()
+        void dispatch_results(concurrency::container<query_queue>& queue)
         {
+            std::vector<curl_easy_request> finished_requests{};
+
             while (true)
             {
                 int msg_in_queue{};
@@ -421,20 +975,59 @@ namespace utils::http
                     throw std::runtime_error("Bad request entry!");
                 }
 
-                if (!entry->second.is_cancelled())
-                {
-                    entry->second.notify(msg->data.result == CURLE_OK);
-                }
+                this->record_transfer(entry->second, msg->data.result);
+
+                // Stopped waiters receive an empty result
+                entry->second.notify(msg->data.result == CURLE_OK);
 
+                finished_requests.emplace_back(std::move(entry->second));
                 this->active_requests_.erase(entry);
             }
+
+            release_transfers(queue, finished_requests);
+        }
+
+        size_t get_max_requests() const
+        {
+            const auto limit = this->controller_->get_limit();
+            return (limit + this->worker_count_ - 1) / this->worker_count_;
+        }
+
+        void record_transfer(const curl_easy_request& request, const CURLcode code) const
+        {
+            curl_off_t total_time{};
+            curl_off_t size{};
+            curl_easy_getinfo(request.get_request(), CURLINFO_TOTAL_TIME_T, &total_time);
+            curl_easy_getinfo(request.get_request(), CURLINFO_SIZE_DOWNLOAD_T, &size);
+
+            // Missing files are an answer, only unreachable or overloaded servers count as failures
+            const auto status = request.get_status_code();
+            const auto failed = (code != CURLE_OK && status == 0) || status == 429 || status >= 500;
+
+            this->controller_->record_transfer(std::chrono::microseconds(total_time), static_cast<uint64_t>(size), failed);
+        }
+
+        static void release_transfers(concurrency::container<query_queue>& queue, const std::vector<curl_easy_request>& requests)
+        {
+            if (requests.empty())
+            {
+                return;
+            }
+
+            queue.access([&requests](query_queue& q) {
+                for (const auto& request : requests)
+                {
+                    q.remove_transfer(request.get_url(), request.get_transfer());
+                }
+            });
         }
     };
 
-    worker_thread::worker_thread(concurrency::container<query_queue>& queue, std::condition_variable& cv, const size_t max_requests)
+    worker_thread::worker_thread(concurrency::container<query_queue>& queue, std::condition_variable& cv,
+                                 concurrency_controller& controller, const size_t worker_count)
         : queue_(&queue),
           cv_(&cv),
-          worker_(std::make_unique<worker>(max_requests)),
+          worker_(std::make_unique<worker>(controller, worker_count)),
           thread_(thread::create_named_jthread("HTTP Worker", [this](const utils::thread::stop_token& token) {
               while (!token.stop_requested())
               {
@@ -519,51 +1112,82 @@ namespace utils::http
     }
 
     downloader::downloader(const size_t num_worker_threads, const size_t max_downloads)
+        : controller_(max_downloads)
     {
-        constexpr auto min_per_thread = static_cast<size_t>(1);
-        const auto requests_per_thread = std::max(min_per_thread, max_downloads / num_worker_threads);
-
         this->workers_.reserve(num_worker_threads);
         for (size_t i = 0; i < num_worker_threads; ++i)
         {
-            this->workers_.emplace_back(std::make_unique<worker_thread>(this->queue_, this->cv_, requests_per_thread));
+            this->workers_.emplace_back(std::make_unique<worker_thread>(this->queue_, this->cv_, this->controller_, num_worker_threads));
         }
     }
 
     downloader::~downloader() = default;
 
-    std::future<result> downloader::download(url_string url, utils::thread::stop_token token, const bool high_priority)
+    std::future<result> downloader::download(url_string url, utils::thread::stop_token token, const request_priority priority)
     {
         auto promise = std::make_shared<std::promise<result>>();
         auto future = promise->get_future();
 
         this->download(
-            std::move(url), [p = std::move(promise)](result result) { p->set_value(std::move(result)); }, std::move(token), high_priority);
+            std::move(url), [p = std::move(promise)](result result) { p->set_value(std::move(result)); }, std::move(token), priority);
 
         return future;
     }
 
-    void downloader::download(url_string url, result_function function, utils::thread::stop_token token, const bool high_priority)
+    void downloader::download(url_string url, result_function function, utils::thread::stop_token token, const request_priority priority)
     {
-        this->queue_.access([&](query_queue& queue) {
-            query q{std::move(url), stoppable_result_callback{std::move(function), std::move(token)}};
+        this->download(
+            std::move(url),
+            [f = std::move(function)](response r) {
+                if (r.data)
+                {
+                    f(std::string{r.data->view()});
+                }
+                else
+                {
+                    f({});
+                }
+            },
+            std::move(token), priority);
+    }
 
-            if (high_priority)
-            {
-                queue.emplace_front(std::move(q));
-            }
-            else
+    void downloader::download(url_string url, response_function function, utils::thread::stop_token token,
+                              const request_priority priority)
+    {
+        stoppable_result_callback callback{std::move(function), std::move(token)};
+
+        const auto joined = this->queue_.access<bool>([&](query_queue& queue) {
+            const auto existing = queue.find_transfer(url);
+            if (existing && existing->join(callback))
             {
-                queue.emplace_back(std::move(q));
+                queue.raise_priority(url, priority);
+                return true;
             }
+
+            auto t = std::make_shared<transfer>(std::move(callback));
+            queue.add_transfer(url, t);
+            queue.push(query{std::move(url), std::move(t)}, priority);
+            return false;
         });
 
+        if (joined)
+        {
+            return;
+        }
+
         std::atomic_thread_fence(std::memory_order_release);
 
         this->wakeup();
         this->cv_.notify_one();
     }
 
+    bool downloader::update_priority(const url_string& url, const request_priority priority)
+    {
+        return this->queue_.access<bool>([&](query_queue& queue) {
+            return queue.update_priority(url, priority); //
+        });
+    }
+
     void downloader::stop()
     {
         for (const auto& worker : this->workers_)
@@ -592,6 +1216,11 @@ namespace utils::http
         return downloads;
     }
 
+    concurrency_controller::state downloader::get_concurrency_state() const
+    {
+        return this->controller_.get_state();
+    }
+
     void downloader::wakeup() const
     {
         for (const auto& w : this->workers_)
@@ -1,14 +1,18 @@
 #pragma once
 
 #include <deque>
+#include <mutex>
+#include <atomic>
 #include <chrono>
 #include <future>
 #include <string>
 #include <vector>
 #include <thread>
 #include <optional>
+#include <limits>
 #include <unordered_map>
 
+#include "buffer.hpp"
 #include "concurrency.hpp"
 #include "thread.hpp"
 
@@ -18,12 +22,20 @@ namespace utils::http
     using result = std::optional<std::string>;
     using result_function = std::function<void(result)>;
 
+    struct response
+    {
+        std::optional<shared_buffer> data{}; // shared between coalesced waiters, never copied
+        long status{}; // HTTP status code, 0 if the server could not be reached
+    };
+
+    using response_function = std::function<void(response)>;
+
     class stoppable_result_callback
     {
       public:
         stoppable_result_callback() = default;
 
-        stoppable_result_callback(result_function callback, utils::thread::stop_token token)
+        stoppable_result_callback(response_function callback, utils::thread::stop_token token)
             : token_(std::move(token)),
               callback_(std::move(callback))
         {
@@ -58,7 +70,7 @@ namespace utils::http
             return *this;
         }
 
-        void operator()(result r)
+        void operator()(response r)
         {
             if (this->callback_)
             {
@@ -82,7 +94,7 @@ namespace utils::http
 
       private:
         utils::thread::stop_token token_{};
-        result_function callback_{};
+        response_function callback_{};
 
         void destroy()
         {
@@ -96,13 +108,138 @@ namespace utils::http
         }
     };
 
+    // All callbacks waiting for one URL. Identical requests join a queued or running transfer instead of starting
+    // another one, the transfer only counts as cancelled once every waiter was stopped.
+    class transfer
+    {
+      public:
+        transfer(stoppable_result_callback callback);
+
+        transfer(const transfer&) = delete;
+        transfer& operator=(const transfer&) = delete;
+
+        transfer(transfer&&) = delete;
+        transfer& operator=(transfer&&) = delete;
+
+        // Fails if the transfer already completed, the callback is only consumed on success
+        bool join(stoppable_result_callback& callback);
+        void complete(response r);
+
+        // Completes the transfer without a result if all waiters were stopped
+        bool try_cancel();
+
+      private:
+        mutable std::mutex mutex_{};
+        std::vector<stoppable_result_callback> waiters_{};
+        bool completed_{false};
+    };
+
     struct query
     {
         url_string url;
-        stoppable_result_callback callback;
+        std::shared_ptr<transfer> waiters;
     };
 
-    using query_queue = std::deque<query>;
+    // Higher values are downloaded first, equal priorities keep their arrival order
+    using request_priority = double;
+    constexpr request_priority highest_priority = std::numeric_limits<request_priority>::max();
+
+    // Binary max-heap with a position index, so queued requests can be re-prioritized in O(log n)
+    class query_queue
+    {
+      public:
+        void push(query q, request_priority priority);
+        query pop();
+
+        bool update_priority(const url_string& url, request_priority priority);
+        bool raise_priority(const url_string& url, request_priority priority);
+
+        // Transfers stay registered from the first request until they completed, queued or running
+        std::shared_ptr<transfer> find_transfer(const url_string& url);
+        void add_transfer(const url_string& url, const std::shared_ptr<transfer>& t);
+        void remove_transfer(const url_string& url, const transfer* t);
+
+        bool empty() const;
+        size_t size() const;
+
+      private:
+        struct entry
+        {
+            query q{};
+            request_priority priority{};
+            uint64_t sequence{};
+        };
+
+        std::vector<entry> heap_{};
+        std::unordered_map<url_string, size_t> positions_{}; // most recently queued entry per URL
+        uint64_t next_sequence_{0};
+
+        std::unordered_map<url_string, std::weak_ptr<transfer>> transfers_{};
+
+        bool is_before(size_t a, size_t b) const;
+        void swap_entries(size_t a, size_t b);
+        void sift_up(size_t index);
+        void sift_down(size_t index);
+    };
+
+    // Adjusts the number of simultaneous transfers, additive increase while the link keeps up,
+    // multiplicative decrease on errors, latency spikes or falling throughput
+    class concurrency_controller
+    {
+      public:
+        static constexpr size_t min_limit = 4;
+        static constexpr size_t max_limit = 256;
+        static constexpr size_t increase_step = 4;
+        static constexpr double decrease_factor = 0.7;
+        static constexpr size_t min_samples = 8;
+        static constexpr std::chrono::milliseconds window{1000};
+
+        enum class decision
+        {
+            hold,
+            increase,
+            decrease,
+        };
+
+        struct state
+        {
+            size_t limit{};
+            decision last_decision{decision::hold};
+            double throughput{}; // bytes per second
+            std::chrono::milliseconds latency{};
+            double error_rate{};
+        };
+
+        concurrency_controller(size_t initial_limit);
+
+        void record_transfer(std::chrono::microseconds latency, uint64_t bytes, bool failed);
+
+        // Requests were left queued because all slots were taken
+        void record_saturation();
+
+        size_t get_limit() const;
+        state get_state() const;
+
+      private:
+        using clock = std::chrono::steady_clock;
+
+        mutable std::mutex mutex_{};
+        std::atomic_size_t limit_{};
+        state state_{};
+
+        clock::time_point window_start_{clock::now()};
+        size_t transfers_{};
+        size_t failures_{};
+        uint64_t bytes_{};
+        std::chrono::microseconds latency_sum_{};
+        bool saturated_{false};
+
+        bool was_saturated_{false};
+        double previous_throughput_{};
+        std::chrono::microseconds baseline_latency_{};
+
+        void evaluate(clock::time_point now);
+    };
 
     using headers = std::unordered_map<std::string, std::string>;
 
@@ -114,7 +251,8 @@ namespace utils::http
     class worker_thread
     {
       public:
-        worker_thread(concurrency::container<query_queue>& queue, std::condition_variable& cv, size_t max_requests);
+        worker_thread(concurrency::container<query_queue>& queue, std::condition_variable& cv, concurrency_controller& controller,
+                      size_t worker_count);
         ~worker_thread();
 
         worker_thread(const worker_thread&) = delete;
@@ -162,16 +300,22 @@ namespace utils::http
         downloader(downloader&&) = delete;
         downloader& operator=(downloader&&) = delete;
 
-        std::future<result> download(url_string url, utils::thread::stop_token token = {}, bool high_priority = false);
-        void download(url_string url, result_function function, utils::thread::stop_token token = {}, bool high_priority = false);
+        std::future<result> download(url_string url, utils::thread::stop_token token = {}, request_priority priority = 0.0);
+        void download(url_string url, result_function function, utils::thread::stop_token token = {}, request_priority priority = 0.0);
+        void download(url_string url, response_function function, utils::thread::stop_token token = {}, request_priority priority = 0.0);
+
+        // Moves a queued request, has no effect once the transfer started
+        bool update_priority(const url_string& url, request_priority priority);
 
         void stop();
 
         size_t get_downloads() const;
+        concurrency_controller::state get_concurrency_state() const;
 
       private:
         concurrency::container<query_queue> queue_{};
         std::condition_variable cv_{};
+        concurrency_controller controller_;
         std::vector<std::unique_ptr<worker_thread>> workers_{};
 
         void wakeup() const;
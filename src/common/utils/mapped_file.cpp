@@ -0,0 +1,125 @@
+#include "mapped_file.hpp"
+
+#include <stdexcept>
+
+#ifdef _WIN32
+#include "nt.hpp"
+#else
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#endif
+
+namespace utils
+{
+    std::shared_ptr<mapped_file> mapped_file::open(const std::filesystem::path& file)
+    {
+        std::shared_ptr<mapped_file> result{new mapped_file()};
+
+#ifdef _WIN32
+        auto* const handle = CreateFileW(file.wstring().c_str(), GENERIC_READ, FILE_SHARE_READ | FILE_SHARE_WRITE | FILE_SHARE_DELETE,
+                                         nullptr, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, nullptr);
+        if (handle == INVALID_HANDLE_VALUE)
+        {
+            return {};
+        }
+
+        result->file_ = handle;
+
+        LARGE_INTEGER size{};
+        if (!GetFileSizeEx(handle, &size))
+        {
+            return {};
+        }
+
+        if (size.QuadPart == 0)
+        {
+            return result;
+        }
+
+        auto* const mapping = CreateFileMappingW(handle, nullptr, PAGE_READONLY, 0, 0, nullptr);
+        if (!mapping)
+        {
+            return {};
+        }
+
+        result->mapping_ = mapping;
+
+        const auto* view = MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0);
+        if (!view)
+        {
+            return {};
+        }
+
+        result->data_ = static_cast<const uint8_t*>(view);
+        result->size_ = static_cast<size_t>(size.QuadPart);
+#else
+        const auto fd = ::open(file.c_str(), O_RDONLY | O_CLOEXEC);
+        if (fd < 0)
+        {
+            return {};
+        }
+
+        struct stat info{};
+        if (fstat(fd, &info) != 0)
+        {
+            close(fd);
+            return {};
+        }
+
+        if (info.st_size > 0)
+        {
+            auto* view = mmap(nullptr, static_cast<size_t>(info.st_size), PROT_READ, MAP_SHARED, fd, 0);
+            if (view == MAP_FAILED)
+            {
+                close(fd);
+                return {};
+            }
+
+            result->data_ = static_cast<const uint8_t*>(view);
+            result->size_ = static_cast<size_t>(info.st_size);
+        }
+
+        // The mapping stays valid after closing the descriptor
+        close(fd);
+#endif
+
+        return result;
+    }
+
+    mapped_file::~mapped_file()
+    {
+#ifdef _WIN32
+        if (this->data_)
+        {
+            UnmapViewOfFile(this->data_);
+        }
+
+        if (this->mapping_)
+        {
+            CloseHandle(this->mapping_);
+        }
+
+        if (this->file_)
+        {
+            CloseHandle(this->file_);
+        }
+#else
+        if (this->data_)
+        {
+            munmap(const_cast<uint8_t*>(this->data_), this->size_);
+        }
+#endif
+    }
+
+    shared_buffer mapped_file::slice(const size_t offset, const size_t size) const
+    {
+        if (offset > this->size_ || size > this->size_ - offset)
+        {
+            throw std::out_of_range("Mapped file slice out of range");
+        }
+
+        return {this->shared_from_this(), this->data_ + offset, size};
+    }
+}
@@ -0,0 +1,49 @@
+#pragma once
+
+#include "buffer.hpp"
+
+#include <memory>
+#include <filesystem>
+
+namespace utils
+{
+    // Read-only view of a whole file. Keeps the file shareable for writers and deleters, callers have to make sure
+    // the mapped range is not modified underneath them.
+    class mapped_file : public std::enable_shared_from_this<mapped_file>
+    {
+      public:
+        static std::shared_ptr<mapped_file> open(const std::filesystem::path& file);
+
+        ~mapped_file();
+
+        mapped_file(const mapped_file&) = delete;
+        mapped_file& operator=(const mapped_file&) = delete;
+
+        mapped_file(mapped_file&&) = delete;
+        mapped_file& operator=(mapped_file&&) = delete;
+
+        const uint8_t* data() const
+        {
+            return this->data_;
+        }
+
+        size_t size() const
+        {
+            return this->size_;
+        }
+
+        // The slice keeps the mapping alive
+        shared_buffer slice(size_t offset, size_t size) const;
+
+      private:
+        mapped_file() = default;
+
+        const uint8_t* data_{};
+        size_t size_{};
+
+#ifdef _WIN32
+        void* file_{};
+        void* mapping_{};
+#endif
+    };
+}
@@ -0,0 +1,318 @@
+#include "std_include.hpp"
+
+#include "rocktree/rocktree.hpp"
+
+#include <utils/thread.hpp>
+
+namespace
+{
+    constexpr double rad2deg = 180.0 / glm::pi<double>();
+
+    struct lat_lon
+    {
+        double lat{};
+        double lon{};
+    };
+
+    struct prefetch_options
+    {
+        std::vector<lat_lon> polygon{};
+        size_t min_lod{1};
+        size_t max_lod{20};
+        std::string planet{"earth"};
+        std::string base_url{rocktree::default_base_url};
+    };
+
+    struct prefetch_state
+    {
+        std::unordered_set<octant_identifier<>> finished_nodes{};
+        size_t fetched_nodes{};
+        size_t failed_nodes{};
+        size_t ready_bulks{};
+        size_t pending{};
+    };
+
+    void print_usage()
+    {
+        puts("Usage: bird-prefetch <lat,lon> <lat,lon> <lat,lon> [...] [--min-lod N] [--max-lod N] [--planet NAME] [--url BASE_URL]");
+        puts("Walks the bulk hierarchy inside the polygon and fills the tile cache with every node in the LOD range.");
+    }
+
+    lat_lon parse_point(const std::string& text)
+    {
+        const auto separator = text.find(',');
+        if (separator == std::string::npos)
+        {
+            throw std::runtime_error("Invalid point: " + text);
+        }
+
+        return {std::stod(text.substr(0, separator)), std::stod(text.substr(separator + 1))};
+    }
+
+    prefetch_options parse_options(const int argc, char** argv)
+    {
+        prefetch_options options{};
+
+        for (int i = 1; i < argc; ++i)
+        {
+            const std::string arg = argv[i];
+            const auto has_value = (i + 1) < argc;
+
+            if (arg == "--min-lod" && has_value)
+            {
+                options.min_lod = std::stoul(argv[++i]);
+            }
+            else if (arg == "--max-lod" && has_value)
+            {
+                options.max_lod = std::stoul(argv[++i]);
+            }
+            else if (arg == "--planet" && has_value)
+            {
+                options.planet = argv[++i];
+            }
+            else if (arg == "--url" && has_value)
+            {
+                options.base_url = argv[++i];
+            }
+            else
+            {
+                options.polygon.emplace_back(parse_point(arg));
+            }
+        }
+
+        if (options.polygon.size() < 3)
+        {
+            throw std::runtime_error("The polygon needs at least 3 points");
+        }
+
+        if (options.min_lod > options.max_lod)
+        {
+            throw std::runtime_error("The minimum LOD exceeds the maximum LOD");
+        }
+
+        return options;
+    }
+
+    lat_lon ecef_to_lat_lon(const glm::dvec3& ecef)
+    {
+        const auto length = glm::length(ecef);
+        if (length <= 0.0)
+        {
+            return {};
+        }
+
+        return {asin(ecef.z / length) * rad2deg, atan2(ecef.y, ecef.x) * rad2deg};
+    }
+
+    bool is_inside(const std::vector<lat_lon>& polygon, const lat_lon& point)
+    {
+        bool inside = false;
+
+        for (size_t i = 0, j = polygon.size() - 1; i < polygon.size(); j = i++)
+        {
+            const auto& a = polygon[i];
+            const auto& b = polygon[j];
+
+            if ((a.lat > point.lat) != (b.lat > point.lat) &&
+                point.lon < (b.lon - a.lon) * (point.lat - a.lat) / (b.lat - a.lat) + a.lon)
+            {
+                inside = !inside;
+            }
+        }
+
+        return inside;
+    }
+
+    double get_distance_to_segment(const lat_lon& point, const lat_lon& a, const lat_lon& b, const double lon_scale)
+    {
+        const glm::dvec2 p{point.lon * lon_scale, point.lat};
+        const glm::dvec2 start{a.lon * lon_scale, a.lat};
+        const glm::dvec2 end{b.lon * lon_scale, b.lat};
+
+        const auto segment = end - start;
+        const auto length2 = glm::dot(segment, segment);
+        const auto t = length2 > 0.0 ? std::clamp(glm::dot(p - start, segment) / length2, 0.0, 1.0) : 0.0;
+
+        return glm::distance(p, start + segment * t);
+    }
+
+    // Approximates the node by a circle in lat/lon space, good enough away from the poles and the antimeridian
+    bool intersects(const std::vector<lat_lon>& polygon, const oriented_bounding_box& obb)
+    {
+        const auto center = ecef_to_lat_lon(obb.center);
+        if (is_inside(polygon, center))
+        {
+            return true;
+        }
+
+        const auto distance = glm::length(obb.center);
+        if (distance <= 0.0)
+        {
+            return false;
+        }
+
+        const auto radius = asin(std::min(1.0, glm::length(obb.extents) / distance)) * rad2deg;
+        const auto lon_scale = std::max(cos(center.lat / rad2deg), 0.01);
+
+        for (size_t i = 0, j = polygon.size() - 1; i < polygon.size(); j = i++)
+        {
+            if (get_distance_to_segment(center, polygon[j], polygon[i], lon_scale) <= radius)
+            {
+                return true;
+            }
+        }
+
+        return false;
+    }
+
+    void visit_node(const prefetch_options& options, prefetch_state& state, const octant_identifier<>& path, node& n)
+    {
+        if (path.size() < options.min_lod || !n.can_have_data || state.finished_nodes.contains(path))
+        {
+            return;
+        }
+
+        if (n.use())
+        {
+            ++state.fetched_nodes;
+        }
+        else if (n.is_in_final_state() && !n.is_being_deleted())
+        {
+            ++state.failed_nodes;
+        }
+        else
+        {
+            ++state.pending;
+            return;
+        }
+
+        // The data is on disk now, drop the decoded meshes right away
+        state.finished_nodes.insert(path);
+        n.mark_for_deletion();
+        n.try_perform_deletion();
+    }
+
+    void walk(rocktree& tree, const prefetch_options& options, prefetch_state& state)
+    {
+        state.pending = 0;
+        state.ready_bulks = 0;
+
+        auto* planetoid = tree.get_planetoid();
+        if (!planetoid->use() || !planetoid->root_bulk || !planetoid->root_bulk->use())
+        {
+            ++state.pending;
+            return;
+        }
+
+        state.ready_bulks = 1;
+
+        std::queue<std::pair<octant_identifier<>, bulk*>> queue{};
+        queue.emplace(octant_identifier{}, planetoid->root_bulk);
+
+        while (!queue.empty())
+        {
+            auto [current, current_bulk] = std::move(queue.front());
+            queue.pop();
+
+            const auto size = current.size();
+            if (size > 0 && size % 4 == 0)
+            {
+                const auto bulk_entry = current_bulk->bulks.find(current.substr(((size - 1) / 4) * 4, 4));
+                if (bulk_entry == current_bulk->bulks.end())
+                {
+                    continue;
+                }
+
+                current_bulk = bulk_entry->second;
+                if (!current_bulk->use())
+                {
+                    if (!current_bulk->is_in_final_state())
+                    {
+                        ++state.pending;
+                    }
+
+                    continue;
+                }
+
+                ++state.ready_bulks;
+            }
+
+            for (uint8_t o = 0; o < 8; ++o)
+            {
+                auto next = current + o;
+                if (next.size() > options.max_lod)
+                {
+                    continue;
+                }
+
+                const auto node_entry = current_bulk->nodes.find(next.substr(((next.size() - 1) / 4) * 4, 4));
+                if (node_entry == current_bulk->nodes.end())
+                {
+                    continue;
+                }
+
+                auto* n = node_entry->second;
+                if (!intersects(options.polygon, n->obb))
+                {
+                    continue;
+                }
+
+                visit_node(options, state, next, *n);
+                queue.emplace(std::move(next), current_bulk);
+            }
+        }
+    }
+
+    void run(const prefetch_options& options)
+    {
+        rocktree tree{options.planet, options.base_url};
+        prefetch_state state{};
+
+        const auto start = std::chrono::steady_clock::now();
+        auto last_report = start;
+
+        while (true)
+        {
+            walk(tree, options, state);
+
+            const auto now = std::chrono::steady_clock::now();
+            const auto is_done = state.pending == 0 && tree.get_tasks() == 0 && tree.get_downloads() == 0 && tree.get_io_operations() == 0;
+
+            if (is_done || (now - last_report) >= 1s)
+            {
+                last_report = now;
+
+                const auto seconds = std::max(std::chrono::duration<double>(now - start).count(), 0.001);
+                printf("%.1fs: %zu nodes (%.1f/s), %zu failed, %zu bulks, %zu pending, %zu downloads, %zu tasks, %zu io\n", seconds,
+                       state.fetched_nodes, static_cast<double>(state.fetched_nodes) / seconds, state.failed_nodes, state.ready_bulks,
+                       state.pending, tree.get_downloads(), tree.get_tasks(), tree.get_io_operations());
+            }
+
+            if (is_done)
+            {
+                break;
+            }
+
+            tree.advance_epoch();
+            tree.reclaim_objects(100ms);
+            std::this_thread::sleep_for(50ms);
+        }
+    }
+}
+
+int main(const int argc, char** argv)
+{
+    try
+    {
+        utils::thread::set_name("Main");
+        run(parse_options(argc, argv));
+        return 0;
+    }
+    catch (std::exception& e)
+    {
+        puts(e.what());
+        print_usage();
+    }
+
+    return 1;
+}
@@ -0,0 +1,42 @@
+#pragma once
+
+#include <map>
+#include <set>
+#include <list>
+#include <array>
+#include <deque>
+#include <queue>
+#include <thread>
+#include <ranges>
+#include <span>
+#include <atomic>
+#include <vector>
+#include <mutex>
+#include <string>
+#include <chrono>
+#include <memory>
+#include <fstream>
+#include <functional>
+#include <filesystem>
+#include <optional>
+#include <stdexcept>
+#include <string_view>
+#include <unordered_set>
+#include <unordered_map>
+#include <condition_variable>
+#include <algorithm>
+#include <utility>
+#include <limits>
+
+#include <cassert>
+#include <cmath>
+#include <cstdio>
+#include <cstring>
+
+#define GLM_FORCE_SILENT_WARNINGS 1
+#include <glm/glm.hpp>
+#include <glm/gtc/constants.hpp>
+
+#include <xxhash.h>
+
+using namespace std::literals;
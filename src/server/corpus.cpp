@@ -0,0 +1,74 @@
+#include "std_include.hpp"
+
+#include "corpus.hpp"
+
+#include <utils/io.hpp>
+#include <utils/http.hpp>
+
+corpus::corpus(std::filesystem::path directory, std::string upstream_url)
+    : directory_(std::move(directory)),
+      upstream_url_(std::move(upstream_url))
+{
+}
+
+std::optional<std::string> corpus::get(const std::string_view path) const
+{
+    const auto file = this->resolve(path);
+    if (!file)
+    {
+        return {};
+    }
+
+    std::string data{};
+    if (utils::io::read_file(*file, &data))
+    {
+        return data;
+    }
+
+    if (this->upstream_url_.empty())
+    {
+        return {};
+    }
+
+    // Recording mode, misses are fetched from the real server and kept for the next run
+    auto result = utils::http::get_data(this->upstream_url_ + std::string(path));
+    if (result)
+    {
+        utils::io::write_file(*file, *result);
+        ++this->recorded_;
+    }
+
+    return result;
+}
+
+size_t corpus::get_recorded() const
+{
+    return this->recorded_;
+}
+
+std::optional<std::filesystem::path> corpus::resolve(std::string_view path) const
+{
+    while (path.starts_with('/'))
+    {
+        path.remove_prefix(1);
+    }
+
+    // Accept the layout of the original server as well, so both base URLs work
+    if (path.starts_with("rt/"))
+    {
+        path.remove_prefix(3);
+    }
+
+    const auto query = path.find('?');
+    if (query != std::string_view::npos)
+    {
+        path = path.substr(0, query);
+    }
+
+    if (path.empty() || path.find("..") != std::string_view::npos || path.find('\\') != std::string_view::npos)
+    {
+        return {};
+    }
+
+    return this->directory_ / std::filesystem::path(path).relative_path();
+}
@@ -0,0 +1,19 @@
+#pragma once
+
+// Recorded rocktree responses, stored under their request path (e.g. earth/NodeData/pb=...)
+class corpus
+{
+  public:
+    corpus(std::filesystem::path directory, std::string upstream_url = {});
+
+    std::optional<std::string> get(std::string_view path) const;
+
+    size_t get_recorded() const;
+
+  private:
+    std::filesystem::path directory_{};
+    std::string upstream_url_{};
+    mutable std::atomic_size_t recorded_{0};
+
+    std::optional<std::filesystem::path> resolve(std::string_view path) const;
+};
@@ -0,0 +1,277 @@
+#include "std_include.hpp"
+
+#include "http_server.hpp"
+
+namespace
+{
+    constexpr size_t max_header_size = 16 * 1024;
+
+#ifdef MSG_NOSIGNAL
+    constexpr int send_flags = MSG_NOSIGNAL; // a client hanging up must not raise SIGPIPE
+#else
+    constexpr int send_flags = 0;
+#endif
+
+    void close_socket(const SOCKET s)
+    {
+#ifdef _WIN32
+        closesocket(s);
+#else
+        close(s);
+#endif
+    }
+
+    void shutdown_socket(const SOCKET s)
+    {
+#ifdef _WIN32
+        shutdown(s, SD_BOTH);
+#else
+        shutdown(s, SHUT_RDWR);
+#endif
+    }
+
+    bool send_data(const SOCKET s, std::string_view data)
+    {
+        while (!data.empty())
+        {
+            const auto sent = send(s, data.data(), static_cast<int>(data.size()), send_flags);
+            if (sent <= 0)
+            {
+                return false;
+            }
+
+            data.remove_prefix(static_cast<size_t>(sent));
+        }
+
+        return true;
+    }
+
+    std::string_view get_status_text(const int status)
+    {
+        switch (status)
+        {
+        case 200:
+            return "OK";
+        case 400:
+            return "Bad Request";
+        case 404:
+            return "Not Found";
+        case 405:
+            return "Method Not Allowed";
+        case 503:
+            return "Service Unavailable";
+        default:
+            return "Error";
+        }
+    }
+
+    std::string to_lower(std::string_view text)
+    {
+        std::string result(text);
+        std::ranges::transform(result, result.begin(), [](const char c) { return static_cast<char>(tolower(c)); });
+        return result;
+    }
+
+    struct request
+    {
+        std::string method{};
+        std::string path{};
+        bool keep_alive{true};
+    };
+
+    std::optional<request> parse_request(const std::string_view header)
+    {
+        const auto line_end = header.find("\r\n");
+        const auto request_line = header.substr(0, line_end);
+
+        const auto method_end = request_line.find(' ');
+        const auto path_end = request_line.find(' ', method_end + 1);
+        if (method_end == std::string_view::npos || path_end == std::string_view::npos)
+        {
+            return {};
+        }
+
+        request r{};
+        r.method = request_line.substr(0, method_end);
+        r.path = request_line.substr(method_end + 1, path_end - method_end - 1);
+        r.keep_alive = request_line.substr(path_end + 1) != "HTTP/1.0";
+
+        auto rest = header.substr(line_end == std::string_view::npos ? header.size() : line_end + 2);
+        while (!rest.empty())
+        {
+            const auto end = rest.find("\r\n");
+            const auto line = rest.substr(0, end);
+            rest = end == std::string_view::npos ? std::string_view{} : rest.substr(end + 2);
+
+            const auto separator = line.find(':');
+            if (separator == std::string_view::npos || to_lower(line.substr(0, separator)) != "connection")
+            {
+                continue;
+            }
+
+            const auto value = to_lower(line.substr(separator + 1));
+            if (value.find("close") != std::string::npos)
+            {
+                r.keep_alive = false;
+            }
+            else if (value.find("keep-alive") != std::string::npos)
+            {
+                r.keep_alive = true;
+            }
+        }
+
+        return r;
+    }
+}
+
+http_server::http_server(const uint16_t port, handler request_handler, body_sender sender)
+    : handler_(std::move(request_handler)),
+      sender_(std::move(sender))
+{
+    network::initialize_wsa();
+
+    this->socket_ = ::socket(AF_INET, SOCK_STREAM, IPPROTO_TCP);
+    if (this->socket_ == INVALID_SOCKET)
+    {
+        throw std::runtime_error("Failed to create socket");
+    }
+
+    const int reuse = 1;
+    setsockopt(this->socket_, SOL_SOCKET, SO_REUSEADDR, reinterpret_cast<const char*>(&reuse), sizeof(reuse));
+
+    sockaddr_in address{};
+    address.sin_family = AF_INET;
+    address.sin_addr.s_addr = htonl(INADDR_ANY);
+    address.sin_port = htons(port);
+
+    if (bind(this->socket_, reinterpret_cast<const sockaddr*>(&address), sizeof(address)) == SOCKET_ERROR ||
+        listen(this->socket_, SOMAXCONN) == SOCKET_ERROR)
+    {
+        close_socket(this->socket_);
+        throw std::runtime_error("Failed to listen on port " + std::to_string(port));
+    }
+}
+
+http_server::~http_server()
+{
+    this->stop();
+
+    std::unique_lock lock{this->mutex_};
+    this->cv_.wait(lock, [this] { return this->connections_.empty(); });
+}
+
+void http_server::run()
+{
+    while (!this->stop_)
+    {
+        const auto connection = accept(this->socket_, nullptr, nullptr);
+        if (connection == INVALID_SOCKET)
+        {
+            continue;
+        }
+
+        std::lock_guard _{this->mutex_};
+        if (this->stop_)
+        {
+            close_socket(connection);
+            break;
+        }
+
+        this->connections_.push_back(connection);
+
+        std::thread([this, connection] {
+            this->serve_connection(connection);
+
+            std::lock_guard lock{this->mutex_};
+            std::erase(this->connections_, connection);
+            close_socket(connection);
+            this->cv_.notify_all();
+        }).detach();
+    }
+}
+
+void http_server::stop()
+{
+    std::lock_guard _{this->mutex_};
+
+    if (this->stop_.exchange(true))
+    {
+        return;
+    }
+
+    // Unblocks accept and all pending receives
+    shutdown_socket(this->socket_);
+    close_socket(this->socket_);
+
+    for (const auto connection : this->connections_)
+    {
+        shutdown_socket(connection);
+    }
+}
+
+void http_server::serve_connection(const SOCKET connection) const
+{
+    std::string buffer{};
+    std::array<char, 4096> chunk{};
+
+    while (!this->stop_)
+    {
+        const auto header_end = buffer.find("\r\n\r\n");
+        if (header_end == std::string::npos)
+        {
+            if (buffer.size() > max_header_size)
+            {
+                return;
+            }
+
+            const auto received = recv(connection, chunk.data(), static_cast<int>(chunk.size()), 0);
+            if (received <= 0)
+            {
+                return;
+            }
+
+            buffer.append(chunk.data(), static_cast<size_t>(received));
+            continue;
+        }
+
+        const auto r = parse_request(std::string_view(buffer).substr(0, header_end));
+        buffer.erase(0, header_end + 4);
+
+        http_response response{};
+        if (!r)
+        {
+            response.status = 400;
+        }
+        else if (r->method != "GET")
+        {
+            response.status = 405;
+        }
+        else
+        {
+            response = this->handler_(r->path);
+        }
+
+        const auto keep_alive = r && r->keep_alive;
+
+        std::string header{};
+        header += "HTTP/1.1 " + std::to_string(response.status) + " " + std::string(get_status_text(response.status)) + "\r\n";
+        header += "Content-Type: application/octet-stream\r\n";
+        header += "Content-Length: " + std::to_string(response.body.size()) + "\r\n";
+        header += keep_alive ? "Connection: keep-alive\r\n\r\n" : "Connection: close\r\n\r\n";
+
+        const auto send_chunk = [connection](const std::string_view data) {
+            return send_data(connection, data); //
+        };
+
+        if (!send_chunk(header))
+        {
+            return;
+        }
+
+        const auto sent = this->sender_ ? this->sender_(response.body, send_chunk) : send_chunk(response.body);
+        if (!sent || !keep_alive)
+        {
+            return;
+        }
+    }
+}
@@ -0,0 +1,39 @@
+#pragma once
+
+struct http_response
+{
+    int status{200};
+    std::string body{};
+};
+
+// Minimal blocking HTTP/1.1 server, one thread per connection, GET only
+class http_server
+{
+  public:
+    using handler = std::function<http_response(std::string_view path)>;
+    using body_sender = std::function<bool(std::string_view body, const std::function<bool(std::string_view)>& send)>;
+
+    http_server(uint16_t port, handler request_handler, body_sender sender = {});
+    ~http_server();
+
+    http_server(const http_server&) = delete;
+    http_server& operator=(const http_server&) = delete;
+
+    http_server(http_server&&) = delete;
+    http_server& operator=(http_server&&) = delete;
+
+    void run();
+    void stop();
+
+  private:
+    SOCKET socket_{INVALID_SOCKET};
+    handler handler_{};
+    body_sender sender_{};
+    std::atomic_bool stop_{false};
+
+    std::mutex mutex_{};
+    std::condition_variable cv_{};
+    std::vector<SOCKET> connections_{};
+
+    void serve_connection(SOCKET connection) const;
+};
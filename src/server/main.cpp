@@ -0,0 +1,169 @@
+#include "std_include.hpp"
+
+#include "corpus.hpp"
+#include "http_server.hpp"
+#include "traffic_shaper.hpp"
+
+#include <utils/thread.hpp>
+
+namespace
+{
+    struct server_options
+    {
+        std::filesystem::path corpus_directory{};
+        std::string upstream_url{};
+        uint16_t port{8080};
+        shaping_options shaping{};
+    };
+
+    struct server_stats
+    {
+        std::atomic_size_t requests{0};
+        std::atomic_size_t hits{0};
+        std::atomic_size_t misses{0};
+        std::atomic_size_t errors{0};
+        std::atomic_uint64_t bytes{0};
+    };
+
+    void print_usage()
+    {
+        puts("Usage: bird-server --corpus DIR [--port N] [--latency MS] [--jitter MS] [--bandwidth KBPS] [--error-rate 0..1] "
+             "[--record UPSTREAM_URL]");
+        puts("Serves recorded rocktree responses, point the client at it with --url http://localhost:<port>/");
+    }
+
+    server_options parse_options(const int argc, char** argv)
+    {
+        server_options options{};
+
+        for (int i = 1; i < argc; ++i)
+        {
+            const std::string arg = argv[i];
+            if ((i + 1) >= argc)
+            {
+                throw std::runtime_error("Missing value for " + arg);
+            }
+
+            const std::string value = argv[++i];
+
+            if (arg == "--corpus")
+            {
+                options.corpus_directory = value;
+            }
+            else if (arg == "--port")
+            {
+                options.port = static_cast<uint16_t>(std::stoul(value));
+            }
+            else if (arg == "--latency")
+            {
+                options.shaping.latency = std::chrono::milliseconds(std::stoll(value));
+            }
+            else if (arg == "--jitter")
+            {
+                options.shaping.jitter = std::chrono::milliseconds(std::stoll(value));
+            }
+            else if (arg == "--bandwidth")
+            {
+                options.shaping.bytes_per_second = std::stoull(value) * 1024;
+            }
+            else if (arg == "--error-rate")
+            {
+                options.shaping.error_rate = std::stod(value);
+            }
+            else if (arg == "--record")
+            {
+                options.upstream_url = value;
+            }
+            else
+            {
+                throw std::runtime_error("Unknown option: " + arg);
+            }
+        }
+
+        if (options.corpus_directory.empty())
+        {
+            throw std::runtime_error("No corpus directory specified");
+        }
+
+        if (!options.upstream_url.empty() && !options.upstream_url.ends_with('/'))
+        {
+            options.upstream_url.push_back('/');
+        }
+
+        return options;
+    }
+
+    void print_stats(const server_stats& stats, const corpus& c)
+    {
+        printf("%zu requests, %zu hits, %zu misses, %zu errors, %zu recorded, %.2f MB sent\n", stats.requests.load(), stats.hits.load(),
+               stats.misses.load(), stats.errors.load(), c.get_recorded(), static_cast<double>(stats.bytes.load()) / (1024.0 * 1024.0));
+    }
+
+    void run(const server_options& options)
+    {
+        const corpus c{options.corpus_directory, options.upstream_url};
+        const traffic_shaper shaper{options.shaping};
+        server_stats stats{};
+
+        const auto handle_request = [&](const std::string_view path) {
+            ++stats.requests;
+            shaper.delay_response();
+
+            http_response response{};
+
+            if (shaper.should_fail())
+            {
+                ++stats.errors;
+                response.status = 503;
+                return response;
+            }
+
+            auto data = c.get(path);
+            if (!data)
+            {
+                ++stats.misses;
+                response.status = 404;
+                return response;
+            }
+
+            ++stats.hits;
+            stats.bytes += data->size();
+            response.body = std::move(*data);
+            return response;
+        };
+
+        const auto send_body = [&](const std::string_view body, const std::function<bool(std::string_view)>& send) {
+            return shaper.send(body, send); //
+        };
+
+        http_server server{options.port, handle_request, send_body};
+
+        auto stats_thread = utils::thread::create_named_jthread("Stats", [&](const utils::thread::stop_token& token) {
+            while (!token.stop_requested())
+            {
+                std::this_thread::sleep_for(1s);
+                print_stats(stats, c);
+            }
+        });
+
+        printf("Serving %s on port %u\n", options.corpus_directory.generic_string().c_str(), static_cast<unsigned>(options.port));
+        server.run();
+    }
+}
+
+int main(const int argc, char** argv)
+{
+    try
+    {
+        utils::thread::set_name("Main");
+        run(parse_options(argc, argv));
+        return 0;
+    }
+    catch (std::exception& e)
+    {
+        puts(e.what());
+        print_usage();
+    }
+
+    return 1;
+}
@@ -0,0 +1,27 @@
+#pragma once
+
+#include <network/socket.hpp>
+
+#include <map>
+#include <deque>
+#include <array>
+#include <mutex>
+#include <atomic>
+#include <chrono>
+#include <random>
+#include <string>
+#include <thread>
+#include <vector>
+#include <optional>
+#include <algorithm>
+#include <stdexcept>
+#include <filesystem>
+#include <functional>
+#include <string_view>
+#include <unordered_map>
+#include <condition_variable>
+
+#include <cstdio>
+#include <cstring>
+
+using namespace std::literals;
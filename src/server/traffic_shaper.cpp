@@ -0,0 +1,70 @@
+#include "std_include.hpp"
+
+#include "traffic_shaper.hpp"
+
+namespace
+{
+    std::mt19937& get_generator()
+    {
+        thread_local std::mt19937 generator{std::random_device{}()};
+        return generator;
+    }
+}
+
+traffic_shaper::traffic_shaper(shaping_options options)
+    : options_(std::move(options))
+{
+}
+
+void traffic_shaper::delay_response() const
+{
+    auto delay = this->options_.latency;
+
+    if (this->options_.jitter.count() > 0)
+    {
+        std::uniform_int_distribution<int64_t> distribution(-this->options_.jitter.count(), this->options_.jitter.count());
+        delay += std::chrono::milliseconds(distribution(get_generator()));
+    }
+
+    if (delay.count() > 0)
+    {
+        std::this_thread::sleep_for(delay);
+    }
+}
+
+bool traffic_shaper::should_fail() const
+{
+    if (this->options_.error_rate <= 0.0)
+    {
+        return false;
+    }
+
+    std::uniform_real_distribution<double> distribution(0.0, 1.0);
+    return distribution(get_generator()) < this->options_.error_rate;
+}
+
+bool traffic_shaper::send(const std::string_view data, const std::function<bool(std::string_view)>& sender) const
+{
+    if (this->options_.bytes_per_second == 0)
+    {
+        return sender(data);
+    }
+
+    // Roughly 20 chunks per second keeps the pacing smooth without too many syscalls
+    const auto chunk_size = static_cast<size_t>(std::max<uint64_t>(this->options_.bytes_per_second / 20, 1));
+    const auto start = std::chrono::steady_clock::now();
+
+    for (size_t offset = 0; offset < data.size(); offset += chunk_size)
+    {
+        if (!sender(data.substr(offset, chunk_size)))
+        {
+            return false;
+        }
+
+        const auto sent = std::min(offset + chunk_size, data.size());
+        const auto due = start + std::chrono::microseconds(sent * 1'000'000 / this->options_.bytes_per_second);
+        std::this_thread::sleep_until(due);
+    }
+
+    return true;
+}
@@ -0,0 +1,25 @@
+#pragma once
+
+struct shaping_options
+{
+    std::chrono::milliseconds latency{0};
+    std::chrono::milliseconds jitter{0};
+    uint64_t bytes_per_second{0}; // per connection, 0 is unlimited
+    double error_rate{0.0};
+};
+
+// Emulates a remote link: delays each response, injects failures and paces the transfer
+class traffic_shaper
+{
+  public:
+    traffic_shaper(shaping_options options);
+
+    void delay_response() const;
+    bool should_fail() const;
+
+    // Calls the sender with chunks of the data, sleeping in between to stay within the bandwidth limit
+    bool send(std::string_view data, const std::function<bool(std::string_view)>& sender) const;
+
+  private:
+    shaping_options options_{};
+};